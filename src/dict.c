@@ -5,6 +5,8 @@
 #include "hash.h"
 #include "dict.h"
 #include "dict_err.h"
+#include "dict_intern.h"
+#include "dict_index.h"
 
 /* ========== PRIVATE HELPERS ========== */
 
@@ -36,34 +38,40 @@ static void dict_value_copy(DictValue *dest, const DictValue *src){
     }
 }
 
-/// @brief Checks if a hash table cell is available (empty).
+/// @brief Returns the entry stored in a cell, without unsharing its page.
 /// @param dict Dictionary pointer (must not be NULL)
-/// @param cell Cell index to check (must be < dict->capacity)
-/// @return 1 if cell is NULL (available), 0 otherwise
+/// @param cell Cell index to read (must be < dict->capacity)
+/// @return Entry on the cell, NULL if the cell is empty
 /// @note Asserts if dict is NULL or cell is out of bounds
-static int is_avaible(Dict *dict, uint32_t cell){
+static DictEntry *slot_get(Dict *dict, uint32_t cell){
     assert(dict != NULL);
     assert(cell < dict->capacity);
-    return dict->entries[cell] == NULL ? 1: 0;
+    DictPage *page = dict->pages[cell >> DICT_PAGE_SHIFT];
+    return page == NULL ? NULL : page->slots[cell & DICT_PAGE_MASK];
 }
 
-/// @brief Checks if dictionary is empty.
+/// @brief Checks if a hash table cell is available (empty).
 /// @param dict Dictionary pointer (must not be NULL)
-/// @return 1 if empty (size == 0), 0 otherwise
-/// @note Asserts if dict is NULL
-static int is_empty(Dict *dict){
-    assert(dict != NULL);
-    return dict->size == 0;
+/// @param cell Cell index to check (must be < dict->capacity)
+/// @return 1 if cell is NULL (available), 0 otherwise
+/// @note Asserts if dict is NULL or cell is out of bounds
+static int is_avaible(Dict *dict, uint32_t cell){
+    return slot_get(dict, cell) == NULL ? 1: 0;
 }
 
 /// @brief Frees all memory associated with a dictionary entry.
+/// @param pool Pool of interned strings of the dictionary (can be NULL)
 /// @param entry Entry to free (must not be NULL)
 /// @note Asserts if entry is NULL
 /// @note Frees key, value, and string data if type is DICT_TYPE_STRING
-static void free_entry(DictEntry *entry){
+static void free_entry(DictStrPool *pool, DictEntry *entry){
     assert(entry != NULL);
-    if(entry->value->type==DICT_TYPE_STRING && entry->value->s != NULL)
-        free(entry->value->s);
+    if(entry->value != NULL && entry->value->type == DICT_TYPE_STRING && entry->value->s != NULL){
+        if(pool != NULL)
+            strpool_release(pool, entry->value->s);
+        else
+            free(entry->value->s);
+    }
     if(entry->value != NULL) 
         free(entry->value);
     if(entry->key != NULL) 
@@ -71,6 +79,163 @@ static void free_entry(DictEntry *entry){
     free(entry);
 }
 
+/// @brief Drops one reference to an entry, freeing it on the last one.
+/// @param pool Pool of interned strings of the dictionary (can be NULL)
+/// @param entry Entry to release (must not be NULL)
+static void entry_release(DictStrPool *pool, DictEntry *entry){
+    assert(entry != NULL);
+    // acq_rel: the thread freeing the entry sees every write of the others.
+    if(atomic_fetch_sub_explicit(&entry->refcount, 1, memory_order_acq_rel) == 1)
+        free_entry(pool, entry);
+}
+
+/// @brief Drops one reference to a page, releasing its entries on the last one.
+/// @param pool Pool of interned strings of the dictionary (can be NULL)
+/// @param page Page to release (must not be NULL)
+static void page_release(DictStrPool *pool, DictPage *page){
+    assert(page != NULL);
+    if(atomic_fetch_sub_explicit(&page->refcount, 1, memory_order_acq_rel) != 1)
+        return;
+
+    for(uint32_t i = 0; i < DICT_PAGE_SIZE; i++){
+        if(page->slots[i] != NULL)
+            entry_release(pool, page->slots[i]);
+    }
+    free(page);
+}
+
+/// @brief Allocates a new entry holding a deep-copy of a key and value view.
+/// @param pool Pool of interned strings of the dictionary (can be NULL)
+/// @param key Key bytes (must not be NULL, need not be null-terminated)
+/// @param klen Bytes of key
+/// @param item Value to copy (must not be NULL)
+/// @param slen Bytes of item->s, for DICT_TYPE_STRING (need not be null-terminated)
+/// @param interned 1 if item->s already belongs to pool, 0 otherwise
+/// @return Entry with refcount 1 on success, NULL otherwise
+/// @note With a pool, string values are interned instead of copied; an
+///       already interned string only takes a new reference
+static DictEntry *entry_create_n(DictStrPool *pool, const char *key, size_t klen,
+                                 const DictValue *item, size_t slen, int interned){
+    assert(key != NULL);
+    assert(item != NULL);
+
+    DictEntry *entry = calloc(1, sizeof(*entry));
+    if (entry == NULL) SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    atomic_init(&entry->refcount, 1);
+
+    entry->key = malloc(klen+1);
+    if(entry->key == NULL) {
+        free_entry(pool, entry);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+
+    entry->value = calloc(1, sizeof(*entry->value));
+    if(entry->value == NULL) {
+        free_entry(pool, entry);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+
+    memcpy(entry->key, key, klen);
+    entry->key[klen] = '\0';
+    if(item->type != DICT_TYPE_STRING){
+        dict_value_copy(entry->value, item);
+        return entry;
+    }
+
+    entry->value->type = DICT_TYPE_STRING;
+    if(pool != NULL){
+        entry->value->s = interned ? strpool_ref(item->s) : strpool_intern_n(pool, item->s, slen);
+        if(entry->value->s == NULL){
+            free_entry(pool, entry);
+            return NULL;
+        }
+        return entry;
+    }
+
+    entry->value->s = malloc(slen + 1);
+    if(entry->value->s == NULL){
+        free_entry(pool, entry);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+    memcpy(entry->value->s, item->s, slen);
+    entry->value->s[slen] = '\0';
+
+    return entry;
+}
+
+/// @brief Allocates a new entry holding a deep-copy of `key` and `item`.
+/// @param pool Pool of interned strings of the dictionary (can be NULL)
+/// @param key Key string (must not be NULL)
+/// @param item Value to copy (must not be NULL)
+/// @param interned 1 if item->s already belongs to pool, 0 otherwise
+/// @return Entry with refcount 1 on success, NULL otherwise
+static DictEntry *entry_create(DictStrPool *pool, const char *key, const DictValue *item, int interned){
+    size_t slen = item->type == DICT_TYPE_STRING ? strlen(item->s) : 0;
+    return entry_create_n(pool, key, strlen(key), item, slen, interned);
+}
+
+/// @brief Returns a writable pointer to a cell, unsharing its page if needed.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param cell Cell index to write (must be < dict->capacity)
+/// @return Pointer to the slot on success, NULL otherwise
+/// @note A missing page is allocated, a shared page is copied: the copy
+///       takes a new reference on every entry of the page.
+static DictEntry **slot_mut(Dict *dict, uint32_t cell){
+    assert(dict != NULL);
+    assert(cell < dict->capacity);
+
+    uint32_t p = cell >> DICT_PAGE_SHIFT;
+    DictPage *page = dict->pages[p];
+
+    if(page == NULL){
+        page = calloc(1, sizeof(*page));
+        if(page == NULL) SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+        atomic_init(&page->refcount, 1);
+        dict->pages[p] = page;
+    } else if(atomic_load_explicit(&page->refcount, memory_order_acquire) > 1){
+        DictPage *copy = malloc(sizeof(*copy));
+        if(copy == NULL) SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+
+        atomic_init(&copy->refcount, 1);
+        memcpy(copy->slots, page->slots, sizeof(page->slots));
+        for(uint32_t i = 0; i < DICT_PAGE_SIZE; i++){
+            if(copy->slots[i] != NULL)
+                atomic_fetch_add_explicit(&copy->slots[i]->refcount, 1, memory_order_relaxed);
+        }
+
+        // The clone may have dropped its reference meanwhile: release, not decrement.
+        page_release(dict->strpool, page);
+        dict->pages[p] = copy;
+        page = copy;
+    }
+
+    return &page->slots[cell & DICT_PAGE_MASK];
+}
+
+/// @brief Returns a writable entry for a non-empty cell, unsharing it if needed.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param cell Cell index to write (must hold an entry)
+/// @return Entry owned only by `dict` on success, NULL otherwise
+static DictEntry *entry_mut(Dict *dict, uint32_t cell){
+    DictEntry **slot = slot_mut(dict, cell);
+    if(slot == NULL)
+        return NULL;
+
+    DictEntry *entry = *slot;
+    assert(entry != NULL);
+    if(atomic_load_explicit(&entry->refcount, memory_order_acquire) == 1)
+        return entry;
+
+    DictEntry *copy = entry_create(dict->strpool, entry->key, entry->value, 1);
+    if(copy == NULL)
+        return NULL;
+
+    entry_release(dict->strpool, entry);
+    *slot = copy;
+
+    return copy;
+}
+
 /// @brief Finds an empty slot for a given key using **double hashing**.
 /// @param dict Dictionary pointer (must not be NULL)
 /// @param key Key string (must not be NULL)
@@ -80,7 +245,7 @@ static uint32_t get_empty_cell(Dict *dict, char *key){
     uint32_t cell = dict->hfn(key, i, dict->capacity);
         
     while(!is_avaible(dict, cell)){
-        if(strcmp(dict->entries[cell]->key, key) == 0)
+        if(strcmp(slot_get(dict, cell)->key, key) == 0)
             SET_ERROR_AND_RETURN(DICT_ERR_ALR_INSERTED, INVALID_CELL);
         if(i == dict->capacity)
             SET_ERROR_AND_RETURN(DICT_ERR_DICT_FULL, INVALID_CELL);
@@ -104,7 +269,7 @@ static uint32_t get_key_cell(Dict *dict, char *key){
         i++;
         if(i == dict->capacity)
             SET_ERROR_AND_RETURN(DICT_ERR_DICT_FULL, INVALID_CELL);
-    } while(!is_avaible(dict, cell) && strcmp(dict->entries[cell]->key, key) != 0);
+    } while(!is_avaible(dict, cell) && strcmp(slot_get(dict, cell)->key, key) != 0);
    
     assert(cell < dict->capacity);
     if (is_avaible(dict, cell))
@@ -113,6 +278,33 @@ static uint32_t get_key_cell(Dict *dict, char *key){
     return cell;
 }
 
+/// @brief Finds, in a single probe sequence, the slot that store the given key
+///        or the empty slot where it would be inserted.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param key Key string (must not be NULL)
+/// @param found Set to 1 if the key is stored in the returned cell, 0 otherwise
+/// @return cell on success, INVALID_CELL otherwise
+static uint32_t find_cell(Dict *dict, const char *key, int *found){
+    uint32_t i = 0;
+    uint32_t cell = dict->hfn(key, i, dict->capacity);
+
+    *found = 0;
+    while(!is_avaible(dict, cell)){
+        if(strcmp(slot_get(dict, cell)->key, key) == 0){
+            *found = 1;
+            return cell;
+        }
+        if(i == dict->capacity)
+            SET_ERROR_AND_RETURN(DICT_ERR_DICT_FULL, INVALID_CELL);
+
+        i++;
+        cell = dict->hfn(key, i, dict->capacity);
+    }
+    assert(cell < dict->capacity);
+
+    return cell;
+}
+
 /// @brief Retrieves the value associated with a given key from the dictionary.
 /// @param dict Dictionary pointer (must not be NULL)
 /// @param key Key string (must not be NULL)
@@ -127,7 +319,112 @@ static DictValue *get_dict_value(Dict *dict, char *key){
     if(cell == INVALID_CELL)
         return NULL;
 
-    return dict->entries[cell]->value;
+    return slot_get(dict, cell)->value;
+}
+
+/// @brief Retrieves the value associated with a given key, ready to be modified.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param key Key string (must not be NULL)
+/// @note If the entry is shared with a clone, it is copied first.
+/// @return DictValue on success, NULL otherwise
+static DictValue *get_dict_value_mut(Dict *dict, char *key){
+    assert(dict);
+    assert(key);
+    dict_clear_error();
+
+    uint32_t cell = get_key_cell(dict, key);
+    if(cell == INVALID_CELL)
+        return NULL;
+
+    DictEntry *entry = entry_mut(dict, cell);
+    if(entry == NULL)
+        return NULL;
+
+    return entry->value;
+}
+
+/// @brief Stores an entry in an empty cell, taking ownership of it.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param cell Empty cell returned by get_empty_cell or find_cell
+/// @param entry Entry with refcount 1 (must not be NULL)
+/// @return 1 on success, 0 on failure (entry is released)
+static int place_at(Dict *dict, uint32_t cell, DictEntry *entry){
+    DictEntry **slot = slot_mut(dict, cell);
+    if(slot == NULL || (dict->index != NULL && !index_add(dict->index, entry->key))){
+        entry_release(dict->strpool, entry);
+        return 0;
+    }
+
+    assert(*slot == NULL);
+    
+    dict->size++;
+    *slot = entry;
+
+    assert(dict->size <= dict->capacity);
+
+    return 1;
+}
+
+/// @brief Stores a new entry for `key` in an empty cell.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param cell Empty cell returned by get_empty_cell or find_cell
+/// @param key Key string (must not be NULL)
+/// @param item Value to copy (must not be NULL)
+/// @return 1 on success, 0 on failure
+static int insert_at(Dict *dict, uint32_t cell, const char *key, const DictValue *item){
+    DictEntry *entry = entry_create(dict->strpool, key, item, 0);
+    if(entry == NULL)
+        return 0;
+
+    return place_at(dict, cell, entry);
+}
+
+/// @brief Overwrites the value stored in a non-empty cell.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param cell Cell holding the entry to update
+/// @param item New value, its string (if any) is copied unless it is the
+///        string currently stored
+/// @return 1 on success, 0 on failure
+/// @note Type between old value and new value must be the same.
+static int update_at(Dict *dict, uint32_t cell, const DictValue *item){
+    char *orig = slot_get(dict, cell)->value->s;
+
+    DictEntry *entry = entry_mut(dict, cell);
+    if(entry == NULL)
+        return 0;
+
+    DictValue *old = entry->value;
+    if(old->type != item->type)
+        SET_ERROR_AND_RETURN(DICT_ERR_MIS_TYPE, 0);
+
+    switch (item->type) {
+    case DICT_TYPE_INT:
+        old->i = item->i;
+        break;
+
+    case DICT_TYPE_DOUBLE:
+        old->d = item->d;
+        break;
+
+    case DICT_TYPE_STRING: {
+        if(item->s == orig)
+            break;
+
+        char *s = dict->strpool != NULL ? strpool_intern(dict->strpool, item->s)
+                                        : strdup(item->s);
+        if(s == NULL)
+            SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+        if(dict->strpool != NULL)
+            strpool_release(dict->strpool, old->s);
+        else
+            free(old->s);
+        old->s = s;
+        break;
+    }
+    }
+
+    return 1;
 }
 
 /**
@@ -155,9 +452,41 @@ Dict *dict_create(uint32_t capacity){
 
     d->size = 0;
     d->capacity = capacity;
-    d->entries = calloc(capacity, sizeof(DictEntry*));
+    d->npages = (capacity + DICT_PAGE_MASK) >> DICT_PAGE_SHIFT;
+    d->pages = calloc(d->npages, sizeof(DictPage*));
     d->hfn = double_bad_hash; // TESTING COLLISION 
-    if (d->entries == NULL) {
+    d->strpool = NULL;
+    d->index = NULL;
+    if (d->pages == NULL) {
+        free(d);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+
+    return d;
+}
+
+/**
+ * Creates a new dictionary with a fixed capacity and interned string values.
+ * 
+ * @param capacity Number of entries the dictionary can hold (must be > 0)
+ * @return Pointer to newly created Dict on success, NULL on failure
+ * 
+ * @note Equal string values share one refcounted, immutable buffer, so
+ *       storing many repeated strings costs one copy per distinct value
+ * @note dict_get() and dict_take() still return a private copy in out->s
+ * @note Caller owns the returned dictionary and must free it with dict_destroy()
+ * @example
+ *   Dict *d = dict_create_interned(100);
+ *   dict_put_string(d, "k1", "eu-west");
+ *   dict_put_string(d, "k2", "eu-west");  // No new copy of "eu-west"
+ */
+Dict *dict_create_interned(uint32_t capacity){
+    Dict *d = dict_create(capacity);
+    if(d == NULL)
+        return NULL;
+
+    d->strpool = strpool_create();
+    if(d->strpool == NULL){
         dict_destroy(d);
         SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
     }
@@ -165,6 +494,54 @@ Dict *dict_create(uint32_t capacity){
     return d;
 }
 
+/**
+ * Creates a copy-on-write clone of the dictionary.
+ * 
+ * @param dict Dictionary to clone (must not be NULL)
+ * @return Pointer to newly created Dict on success, NULL on failure
+ * 
+ * @note Runs in O(capacity / DICT_PAGE_SIZE): pages and entries are shared
+ *       and copied only when one of the two dictionaries writes on them
+ * @note The clone is a consistent snapshot: later writes on either
+ *       dictionary are not visible on the other one
+ * @note The secondary index is not cloned, see dict_index_enable()
+ * @note The clone and the source can be used by two different threads,
+ *       each dictionary still having a single user; dict_clone() itself
+ *       must run on the thread using the source
+ * @note Caller owns the returned dictionary and must free it with dict_destroy()
+ * @example
+ *   Dict *snap = dict_clone(d);
+ *   dict_upd_int(d, "age", 26);  // snap still sees the old value
+ *   dict_destroy(snap);
+ */
+Dict *dict_clone(Dict *dict){
+    dict_clear_error();
+    if(dict == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, NULL);
+
+    Dict *d = malloc(sizeof(Dict));
+    if(d == NULL) 
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+
+    *d = *dict;
+    d->index = NULL;
+    d->pages = malloc(dict->npages * sizeof(DictPage*));
+    if (d->pages == NULL) {
+        free(d);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+
+    for(uint32_t p = 0; p < dict->npages; p++){
+        d->pages[p] = dict->pages[p];
+        if(d->pages[p] != NULL)
+            atomic_fetch_add_explicit(&d->pages[p]->refcount, 1, memory_order_relaxed);
+    }
+    if(d->strpool != NULL)
+        atomic_fetch_add_explicit(&d->strpool->refcount, 1, memory_order_relaxed);
+
+    return d;
+}
+
 
 /* ========== START API INSERT IMPLEMENTATIONS ========== */
 
@@ -184,33 +561,42 @@ static int dict_put(Dict *dict, char *key, DictValue *item){
     uint32_t cell = get_empty_cell(dict, key);
     if(cell == INVALID_CELL)
         return 0;
-    
-    DictEntry *entry = malloc(sizeof(*entry));
-    if (entry == NULL) SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-    
-    entry->key = malloc(strlen(key)+1);
-    if(entry->key == NULL) {
-        free_entry(entry);
-        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-    }
 
-    entry->value = calloc(1, sizeof(*entry->value));
-    if(entry->value == NULL) {
-        free_entry(entry);
-        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-    }
+    return insert_at(dict, cell, key, item);
+}
 
-    strcpy(entry->key, key);
-    dict_value_copy(entry->value, item);
+/**
+ * Inserts a key-value pair given as views into a larger buffer.
+ * 
+ * @param dict Dictionary to insert into (must not be NULL)
+ * @param key Key bytes (must not be NULL, need not be null-terminated)
+ * @param klen Bytes of key, none of them '\0'
+ * @param item Value to insert (must not be NULL)
+ * @param slen Bytes of item->s for DICT_TYPE_STRING, none of them '\0'
+ *        (item->s need not be null-terminated), ignored otherwise
+ * @return 1 on success, 0 on failure
+ * 
+ * @note Key and string are copied straight from the views, so a loader can
+ *       insert from a read-only buffer with a single copy of each
+ * @note The key is copied before probing, as hash functions need a
+ *       null-terminated key: an existing key costs an allocation
+ */
+int dict_put_n(Dict *dict, const char *key, size_t klen, const DictValue *item, size_t slen){
+    dict_clear_error();
+    if(dict == NULL || key == NULL || item == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
 
-    assert(dict->entries[cell] == NULL);
-    
-    dict->size++;
-    dict->entries[cell] = entry;
+    DictEntry *entry = entry_create_n(dict->strpool, key, klen, item, slen, 0);
+    if(entry == NULL)
+        return 0;
 
-    assert(dict->size <= dict->capacity);
+    uint32_t cell = get_empty_cell(dict, entry->key);
+    if(cell == INVALID_CELL){
+        entry_release(dict->strpool, entry);
+        return 0;
+    }
 
-    return 1;
+    return place_at(dict, cell, entry);
 }
 
 /**
@@ -234,17 +620,11 @@ int dict_put_int(Dict *dict, char *key, int val){
     if(dict == NULL || key == NULL) 
         SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
 
-    DictValue *dval = malloc(sizeof(*dval));
-    if(dval == NULL) 
-        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-
-    dval->type = DICT_TYPE_INT;
-    dval->i = val;
+    DictValue dval;
+    dval.type = DICT_TYPE_INT;
+    dval.i = val;
 
-    int res = dict_put(dict, key, dval);
-    free(dval);
-
-    return res;
+    return dict_put(dict, key, &dval);
 }
 
 /**
@@ -266,19 +646,13 @@ int dict_put_int(Dict *dict, char *key, int val){
 int dict_put_double(Dict *dict, char *key, double val){
     dict_clear_error();
     if(dict == NULL || key == NULL) 
-        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-
-    DictValue *dval = malloc(sizeof(*dval));
-    if(dval == NULL)
-        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-
-    dval->type = DICT_TYPE_DOUBLE;
-    dval->d = val;
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
 
-    int res = dict_put(dict, key, dval);
-    free(dval);
+    DictValue dval;
+    dval.type = DICT_TYPE_DOUBLE;
+    dval.d = val;
 
-    return res;
+    return dict_put(dict, key, &dval);
 }
 
 /**
@@ -301,22 +675,12 @@ int dict_put_string(Dict *dict, char *key, char *val){
     if(dict == NULL || key == NULL || val == NULL) 
         SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
 
-    DictValue *dval = malloc(sizeof(*dval));
-    if(dval == NULL) 
-        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-
-    dval->type = DICT_TYPE_STRING;
-    dval->s = strdup(val);
-    if(dval->s == NULL) {
-        free(dval);  
-        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
-    }
-
-    int res = dict_put(dict, key, dval);
-    free(dval->s);
-    free(dval);   
+    // dict_put copies (or interns) the value, val can be used as is.
+    DictValue dval;
+    dval.type = DICT_TYPE_STRING;
+    dval.s = val;
 
-    return res;
+    return dict_put(dict, key, &dval);
 }
 
 /* ========== END API INSERT IMPLEMENTATIONS ========== */
@@ -339,7 +703,7 @@ int dict_upd_int(Dict *dict, char *key, int val){
     if(dict == NULL || key == NULL) 
         SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
 
-    DictValue *old = get_dict_value(dict, key);
+    DictValue *old = get_dict_value_mut(dict, key);
     if(old == NULL) return 0;
 
     if(old->type != DICT_TYPE_INT)
@@ -365,7 +729,7 @@ int dict_upd_double(Dict *dict, char *key, double val){
     if(dict == NULL || key == NULL) 
         SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
 
-    DictValue *old = get_dict_value(dict, key);
+    DictValue *old = get_dict_value_mut(dict, key);
     if(old == NULL) return 0;
 
     if(old->type != DICT_TYPE_DOUBLE)
@@ -386,18 +750,29 @@ int dict_upd_double(Dict *dict, char *key, double val){
  * 
  * @note Type between old value and new value must be the same.
  * @note The val is copied internally; caller retains ownership of original
+ * @note On interned dictionaries the new value is interned and the old one
+ *       released, no copy happens when val is already stored elsewhere
  */
 int dict_upd_string(Dict *dict, char *key, char *val){
     dict_clear_error();
-    if(dict == NULL || key == NULL) 
+    if(dict == NULL || key == NULL || val == NULL) 
         SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
 
-    DictValue *old = get_dict_value(dict, key);
+    DictValue *old = get_dict_value_mut(dict, key);
     if(old == NULL) return 0;
 
     if(old->type != DICT_TYPE_STRING)
         SET_ERROR_AND_RETURN(DICT_ERR_MIS_TYPE, 0);
 
+    if(dict->strpool != NULL){
+        char *s = strpool_intern(dict->strpool, val);
+        if(s == NULL) return 0;
+
+        strpool_release(dict->strpool, old->s);
+        old->s = s;
+        return 1;
+    }
+
     size_t len = strlen(val) + 1;
     char *tmp = realloc(old->s, len);
     if (!tmp) {
@@ -414,6 +789,228 @@ int dict_upd_string(Dict *dict, char *key, char *val){
 
 /* ========== END API UPDATE IMPLEMENTATIONS ========== */
 
+/* ========== START API IN-PLACE UPDATE IMPLEMENTATIONS ========== */
+
+/**
+ * Adds `delta` to an integer value, inserting it if the key is missing.
+ * 
+ * @param dict Dictionary to update into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param delta Value added to the stored integer (stored as is if missing)
+ * @param out Output parameter for the new value (can be NULL)
+ * @return 1 on success, 0 on failure
+ * 
+ * @note Performs a single probe sequence, unlike dict_get() + dict_upd_int()
+ * @note Not atomic: like every write, it must run on the thread using dict
+ * @note The stored value must be of type DICT_TYPE_INT
+ * @example
+ *   dict_incr_int(counts, word, 1, NULL);
+ */
+int dict_incr_int(Dict *dict, char *key, int delta, int *out){
+    dict_clear_error();
+    if(dict == NULL || key == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    int found;
+    uint32_t cell = find_cell(dict, key, &found);
+    if(cell == INVALID_CELL)
+        return 0;
+
+    if(!found){
+        DictValue dval = { .type = DICT_TYPE_INT, .i = delta };
+        if(!insert_at(dict, cell, key, &dval))
+            return 0;
+        if(out != NULL) *out = delta;
+        return 1;
+    }
+
+    if(slot_get(dict, cell)->value->type != DICT_TYPE_INT)
+        SET_ERROR_AND_RETURN(DICT_ERR_MIS_TYPE, 0);
+
+    DictEntry *entry = entry_mut(dict, cell);
+    if(entry == NULL)
+        return 0;
+
+    entry->value->i += delta;
+    if(out != NULL) *out = entry->value->i;
+
+    return 1;
+}
+
+/**
+ * Adds `delta` to a double value, inserting it if the key is missing.
+ * 
+ * @param dict Dictionary to update into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param delta Value added to the stored double (stored as is if missing)
+ * @param out Output parameter for the new value (can be NULL)
+ * @return 1 on success, 0 on failure
+ * 
+ * @note Performs a single probe sequence, unlike dict_get() + dict_upd_double()
+ * @note Not atomic: like every write, it must run on the thread using dict
+ * @note The stored value must be of type DICT_TYPE_DOUBLE
+ */
+int dict_add_double(Dict *dict, char *key, double delta, double *out){
+    dict_clear_error();
+    if(dict == NULL || key == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    int found;
+    uint32_t cell = find_cell(dict, key, &found);
+    if(cell == INVALID_CELL)
+        return 0;
+
+    if(!found){
+        DictValue dval = { .type = DICT_TYPE_DOUBLE, .d = delta };
+        if(!insert_at(dict, cell, key, &dval))
+            return 0;
+        if(out != NULL) *out = delta;
+        return 1;
+    }
+
+    if(slot_get(dict, cell)->value->type != DICT_TYPE_DOUBLE)
+        SET_ERROR_AND_RETURN(DICT_ERR_MIS_TYPE, 0);
+
+    DictEntry *entry = entry_mut(dict, cell);
+    if(entry == NULL)
+        return 0;
+
+    entry->value->d += delta;
+    if(out != NULL) *out = entry->value->d;
+
+    return 1;
+}
+
+/**
+ * Creates or modifies a value through a callback, in a single probe sequence.
+ * 
+ * @param dict Dictionary to update into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param fn Callback computing the new value (must not be NULL)
+ * @param ctx User pointer passed to fn (can be NULL)
+ * @return 1 if the value was stored, 0 on failure or if fn declined
+ * 
+ * @note fn receives a shallow copy of the stored value when found is 1,
+ *       a zeroed value when found is 0; it must not free or modify val->s,
+ *       but can point it to its own string, which is copied internally
+ * @note fn returns 1 to store val, 0 to leave the dictionary untouched
+ * @note When found is 1 the type of val must not change
+ * @example
+ *   static int keep_max(DictValue *val, int found, void *ctx){
+ *       int n = *(int *)ctx;
+ *       if(found && val->i >= n) return 0;
+ *       val->type = DICT_TYPE_INT;
+ *       val->i = n;
+ *       return 1;
+ *   }
+ *   dict_update_with(d, "max", keep_max, &sample);
+ */
+int dict_update_with(Dict *dict, char *key, DictUpdateFn fn, void *ctx){
+    dict_clear_error();
+    if(dict == NULL || key == NULL || fn == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    int found;
+    uint32_t cell = find_cell(dict, key, &found);
+    if(cell == INVALID_CELL)
+        return 0;
+
+    DictValue val;
+    if(found)
+        val = *slot_get(dict, cell)->value;
+    else
+        memset(&val, 0, sizeof(val));
+
+    if(!fn(&val, found, ctx))
+        return 0;
+    if(val.type == DICT_TYPE_STRING && val.s == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    return found ? update_at(dict, cell, &val) : insert_at(dict, cell, key, &val);
+}
+
+/**
+ * Merges every entry of `src` into `dst`.
+ * 
+ * @param dst Dictionary to merge into (must not be NULL)
+ * @param src Dictionary to merge from (must not be NULL, not modified)
+ * @param fn Callback combining a value of src into the value of dst with
+ *        the same key (can be NULL: dst values are kept)
+ * @param ctx User pointer passed to fn (can be NULL)
+ * @return 1 on success, 0 on failure
+ * 
+ * @note Each key of src costs a single probe sequence in dst
+ * @note Keys missing from dst share the src entry (copy-on-write) when both
+ *       dictionaries use the same string pool, or none; otherwise are copied
+ * @note After the merge src and dst share storage, as a clone does: each
+ *       one can still be written, cleaned up or destroyed independently,
+ *       even from another thread, without affecting the other
+ * @note fn follows the rules of DictUpdateFn on its `dst` argument and
+ *       returns 1 to store it, 0 to keep the dst value unchanged
+ * @note On failure the entries merged so far stay in dst
+ * @example
+ *   static int sum(DictValue *dst, const DictValue *src, void *ctx){
+ *       (void)ctx;
+ *       dst->i += src->i;
+ *       return 1;
+ *   }
+ *   for(int t = 0; t < nthreads; t++)
+ *       dict_merge(total, partial[t], sum, NULL);
+ */
+int dict_merge(Dict *dst, Dict *src, DictCombineFn fn, void *ctx){
+    dict_clear_error();
+    if(dst == NULL || src == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+    if(dst == src)
+        return 1;
+
+    int share = dst->strpool == src->strpool;
+
+    for(uint32_t p = 0; p < src->npages; p++){
+        DictPage *page = src->pages[p];
+        if(page == NULL)
+            continue;
+
+        for(uint32_t i = 0; i < DICT_PAGE_SIZE; i++){
+            DictEntry *entry = page->slots[i];
+            if(entry == NULL)
+                continue;
+
+            int found;
+            uint32_t cell = find_cell(dst, entry->key, &found);
+            if(cell == INVALID_CELL)
+                return 0;
+
+            if(found){
+                if(fn == NULL)
+                    continue;
+
+                DictValue val = *slot_get(dst, cell)->value;
+                if(!fn(&val, entry->value, ctx))
+                    continue;
+                if(!update_at(dst, cell, &val))
+                    return 0;
+            } else if(share){
+                DictEntry **slot = slot_mut(dst, cell);
+                if(slot == NULL)
+                    return 0;
+                if(dst->index != NULL && !index_add(dst->index, entry->key))
+                    return 0;
+
+                atomic_fetch_add_explicit(&entry->refcount, 1, memory_order_relaxed);
+                *slot = entry;
+                dst->size++;
+            } else if(!insert_at(dst, cell, entry->key, entry->value)){
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/* ========== END API IN-PLACE UPDATE IMPLEMENTATIONS ========== */
+
 /* ========== START API GET/TAKE IMPLEMENTATIONS ========== */
 
 /**
@@ -479,13 +1076,17 @@ int dict_take(Dict *dict, char *key, DictValue *out){
     uint32_t cell = get_key_cell(dict, key); 
     if(cell == INVALID_CELL)
         return 0;
-        
-    DictValue *val = get_dict_value(dict, key);
 
-    dict_value_copy(out, val);
+    DictEntry **slot = slot_mut(dict, cell);
+    if(slot == NULL)
+        return 0;
+
+    dict_value_copy(out, (*slot)->value);
 
-    free_entry(dict->entries[cell]);
-    dict->entries[cell] = NULL;
+    if(dict->index != NULL)
+        index_remove(dict->index, key);
+    entry_release(dict->strpool, *slot);
+    *slot = NULL;
     dict->size--;
 
     return 1;
@@ -493,12 +1094,207 @@ int dict_take(Dict *dict, char *key, DictValue *out){
 
 /* ========== END API GET/TAKE IMPLEMENTATIONS ========== */
 
+/* ========== START API ITERATION IMPLEMENTATIONS ========== */
+
+/**
+ * Starts an iteration over every entry of the dictionary.
+ * 
+ * @param dict Dictionary to iterate (must not be NULL)
+ * @param it Iterator to initialize (must not be NULL)
+ * 
+ * @note Entries are returned in slot order, skipping unallocated pages
+ * @note Any write on the dictionary invalidates the iterator: iterate on a
+ *       dict_clone() to keep writing meanwhile
+ * @example
+ *   DictIter it;
+ *   const char *key;
+ *   const DictValue *val;
+ *   dict_iter_init(d, &it);
+ *   while (dict_iter_next(&it, &key, &val)) {
+ *       printf("%s\n", key);
+ *   }
+ */
+void dict_iter_init(Dict *dict, DictIter *it){
+    assert(dict != NULL);
+    assert(it != NULL);
+    it->dict = dict;
+    it->cell = 0;
+}
+
+/**
+ * Returns the next entry of the iteration.
+ * 
+ * @param it Iterator started by dict_iter_init() (must not be NULL)
+ * @param key Output parameter for the key (must not be NULL)
+ * @param val Output parameter for the value (must not be NULL)
+ * @return 1 if an entry was returned, 0 when the iteration is over
+ * 
+ * @note key and val are owned by the dictionary and must not be modified
+ */
+int dict_iter_next(DictIter *it, const char **key, const DictValue **val){
+    Dict *dict = it->dict;
+
+    while(it->cell < dict->capacity){
+        DictPage *page = dict->pages[it->cell >> DICT_PAGE_SHIFT];
+        if(page == NULL){
+            uint32_t next = (it->cell | DICT_PAGE_MASK) + 1;
+            it->cell = next > it->cell ? next : dict->capacity;
+            continue;
+        }
+
+        DictEntry *entry = page->slots[it->cell & DICT_PAGE_MASK];
+        it->cell++;
+        if(entry != NULL){
+            *key = entry->key;
+            *val = entry->value;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* ========== END API ITERATION IMPLEMENTATIONS ========== */
+
+/* ========== START API RANGE SCAN IMPLEMENTATIONS ========== */
+
+/**
+ * Enables the ordered secondary index over the keys of the dictionary.
+ * 
+ * @param dict Dictionary to index (must not be NULL)
+ * @return 1 on success (or if already enabled), 0 on failure
+ * 
+ * @note Existing keys are indexed with a single sort
+ * @note From now on every insert and take also updates the index, which
+ *       holds its own copy of each key
+ * @note Point lookups never use the index
+ * @note dict_clone() does not copy the index: clones start without one,
+ *       call dict_index_enable() on the clone to scan it by key order
+ */
+int dict_index_enable(Dict *dict){
+    dict_clear_error();
+    if(dict == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+    if(dict->index != NULL)
+        return 1;
+
+    const char **keys = malloc((dict->size ? dict->size : 1) * sizeof(char*));
+    if(keys == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    uint32_t n = 0;
+    for(uint32_t p = 0; p < dict->npages; p++){
+        DictPage *page = dict->pages[p];
+        if(page == NULL)
+            continue;
+
+        for(uint32_t i = 0; i < DICT_PAGE_SIZE; i++){
+            if(page->slots[i] != NULL)
+                keys[n++] = page->slots[i]->key;
+        }
+    }
+    assert(n == dict->size);
+
+    dict->index = index_create(keys, n);
+    free(keys);
+
+    return dict->index != NULL;
+}
+
+/**
+ * Starts an iteration over every key beginning with `prefix`.
+ * 
+ * @param dict Dictionary with secondary index (must not be NULL)
+ * @param prefix Prefix of the keys (must not be NULL, "" matches every key)
+ * @param it Iterator to initialize (must not be NULL)
+ * @return 1 on success, 0 on failure
+ * 
+ * @note Costs O(log n) to start and O(1) per key, regardless of capacity;
+ *       keys removed since the last scan are dropped first, in O(n)
+ * @example
+ *   DictRangeIter it;
+ *   const char *key;
+ *   dict_prefix_iter(d, "tenant42/", &it);
+ *   while ((key = dict_range_next(&it)) != NULL) {
+ *       printf("%s\n", key);
+ *   }
+ */
+int dict_prefix_iter(Dict *dict, const char *prefix, DictRangeIter *it){
+    dict_clear_error();
+    if(dict == NULL || prefix == NULL || it == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+    if(dict->index == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NO_INDEX, 0);
+    if(!index_flush(dict->index))
+        return 0;
+
+    it->dict = dict;
+    it->pos = index_lower_bound(dict->index, prefix);
+    it->end = index_prefix_end(dict->index, it->pos, prefix);
+
+    return 1;
+}
+
+/**
+ * Starts an iteration over every key in [lo, hi).
+ * 
+ * @param dict Dictionary with secondary index (must not be NULL)
+ * @param lo First key of the range, included (NULL: from the first key)
+ * @param hi Last key of the range, excluded (NULL: up to the last key)
+ * @param it Iterator to initialize (must not be NULL)
+ * @return 1 on success, 0 on failure
+ * 
+ * @note Keys are compared with strcmp()
+ */
+int dict_range_iter(Dict *dict, const char *lo, const char *hi, DictRangeIter *it){
+    dict_clear_error();
+    if(dict == NULL || it == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+    if(dict->index == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NO_INDEX, 0);
+    if(!index_flush(dict->index))
+        return 0;
+
+    it->dict = dict;
+    it->pos = lo == NULL ? 0 : index_lower_bound(dict->index, lo);
+    it->end = hi == NULL ? dict->index->len : index_lower_bound(dict->index, hi);
+    if(it->end < it->pos)
+        it->end = it->pos;
+
+    return 1;
+}
+
+/**
+ * Returns the next key of the iteration.
+ * 
+ * @param it Iterator started by dict_prefix_iter() or dict_range_iter()
+ * @return Key owned by the dictionary, NULL when the iteration is over
+ * 
+ * @note Use dict_get() to read the value of the key
+ */
+const char *dict_range_next(DictRangeIter *it){
+    if(it == NULL)
+        return NULL;
+
+    DictIndex *idx = it->dict->index;
+    while(it->pos < it->end){
+        uint32_t pos = it->pos++;
+        if(!index_is_dead(idx, pos))
+            return idx->keys[pos];
+    }
+
+    return NULL;
+}
+
+/* ========== END API RANGE SCAN IMPLEMENTATIONS ========== */
+
 /**
  * Removes all entries from the dictionary.
  * 
  * @param dict Dictionary to clear (can be NULL)
  * 
  * @note Frees all internal entries and their associated memory
+ * @note Entries still shared with a clone are kept alive for the clone
  * @note The dictionary remains valid and reusable after cleanup
  * @note Size is reset to 0
  * @note Capacity remains unchanged
@@ -511,15 +1307,15 @@ int dict_take(Dict *dict, char *key, DictValue *out){
  */
 void dict_cleanup(Dict *dict){
     if(dict == NULL) return;
-    if(is_empty(dict)) return;
 
-    for(uint32_t i = 0; i < dict->capacity; i++){
-        if (!dict->entries[i])
+    for(uint32_t p = 0; p < dict->npages; p++){
+        if (!dict->pages[p])
             continue;
 
-        free_entry(dict->entries[i]);
-        dict->entries[i] = NULL;
+        page_release(dict->strpool, dict->pages[p]);
+        dict->pages[p] = NULL;
     }
+    index_clear(dict->index);
     
     dict->size = 0;
 }
@@ -544,7 +1340,9 @@ void dict_destroy(Dict *dict){
     if(dict == NULL) return;
 
     dict_cleanup(dict);
+    strpool_unref(dict->strpool);
+    index_destroy(dict->index);
 
-    free(dict->entries);
+    free(dict->pages);
     free(dict);
 }
\ No newline at end of file
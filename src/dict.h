@@ -2,6 +2,7 @@
 #define DICT_H
 #include <stddef.h>
 #include <stdint.h>
+#include <stdatomic.h>
 #include "hash.h"
 
 /* ====== Dictionary constants. ====== */
@@ -9,6 +10,9 @@
 #define DICT_CAP 701
 #define DICT_HASH_PRIMARY "djb2"
 #define DICT_HASH_SECONDARY "fnv1a"
+#define DICT_PAGE_SHIFT 6
+#define DICT_PAGE_SIZE (1u << DICT_PAGE_SHIFT) // Slots per page.
+#define DICT_PAGE_MASK (DICT_PAGE_SIZE - 1)
 
 /* ====== Dictionary struct ====== */
 
@@ -31,29 +35,82 @@ typedef struct {
 typedef struct {
     char *key;
     DictValue *value;
+    _Atomic uint32_t refcount; // How many pages are sharing this entry.
 } DictEntry;
 
+/* A fixed-size chunk of slots.
+ * Pages are shared between cloned dictionaries and copied only when written.
+ * Refcounts are atomic, so a clone can be read and destroyed by another
+ * thread while its source keeps taking writes. */
+typedef struct {
+    _Atomic uint32_t refcount; // How many dictionaries are sharing this page.
+    DictEntry *slots[DICT_PAGE_SIZE];
+} DictPage;
+
+struct DictStrPool;
+struct DictIndex;
+
 /* A simple dictionary.
  * Common operations like insert, remove and search are implemented in O(1). */
 typedef struct {
     uint32_t size; // How many items are actualy storing.
     uint32_t capacity; // How many items can store.
+    uint32_t npages; // How many pages cover the capacity.
     DoubleHashFunction hfn; // Hash function used internally
+    struct DictStrPool *strpool; // Interned string values, NULL if interning is off.
+    struct DictIndex *index; // Ordered keys, NULL if the secondary index is off.
 
-    DictEntry **entries; // List of items.
+    DictPage **pages; // List of pages, NULL until the first write on it.
 } Dict;
 
+/* Callback of dict_update_with().
+ * `val` holds the stored value when `found` is 1, a zeroed value otherwise.
+ * Returns 1 to store `val`, 0 to leave the dictionary untouched. */
+typedef int (*DictUpdateFn)(DictValue *val, int found, void *ctx);
+
+/* Callback of dict_merge().
+ * Combines `src` into `dst`, returns 1 to store `dst`, 0 to keep the old value. */
+typedef int (*DictCombineFn)(DictValue *dst, const DictValue *src, void *ctx);
+
+/* Iterator over every entry of a dictionary.
+ * Invalidated by any write on the dictionary. */
+typedef struct {
+    Dict *dict;
+    uint32_t cell; // Next cell to visit.
+} DictIter;
+
+/* Iterator over a run of keys of the secondary index, in ascending order.
+ * Invalidated by any write on the dictionary. */
+typedef struct {
+    Dict *dict;
+    uint32_t pos; // Position of the next key.
+    uint32_t end; // Position after the last key.
+} DictRangeIter;
+
 /* ====== Dictionary API ====== */
 
 Dict *dict_create(uint32_t capacity);
+Dict *dict_create_interned(uint32_t capacity);
+Dict *dict_clone(Dict *dict);
 int dict_put_int(Dict *dict, char *key, int val);
 int dict_put_double(Dict *dict, char *key, double val);
 int dict_put_string(Dict *dict, char *key, char *val);
+int dict_put_n(Dict *dict, const char *key, size_t klen, const DictValue *item, size_t slen);
 int dict_upd_int(Dict *dict, char *key, int val);
 int dict_upd_double(Dict *dict, char *key, double val);
 int dict_upd_string(Dict *dict, char *key, char *val);
+int dict_incr_int(Dict *dict, char *key, int delta, int *out);
+int dict_add_double(Dict *dict, char *key, double delta, double *out);
+int dict_update_with(Dict *dict, char *key, DictUpdateFn fn, void *ctx);
+int dict_merge(Dict *dst, Dict *src, DictCombineFn fn, void *ctx);
 int dict_take(Dict *dict, char *key, DictValue *out);
 int dict_get(Dict *dict, char *key, DictValue *out);
+void dict_iter_init(Dict *dict, DictIter *it);
+int dict_iter_next(DictIter *it, const char **key, const DictValue **val);
+int dict_index_enable(Dict *dict);
+int dict_prefix_iter(Dict *dict, const char *prefix, DictRangeIter *it);
+int dict_range_iter(Dict *dict, const char *lo, const char *hi, DictRangeIter *it);
+const char *dict_range_next(DictRangeIter *it);
 void dict_cleanup(Dict *dict);
 void dict_destroy(Dict *dict);
 
@@ -0,0 +1,557 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "hash.h"
+#include "utils.h"
+#include "dict_compact.h"
+#include "dict_err.h"
+
+/* ========== PRIVATE HELPERS ========== */
+
+#define REC_HEADER (sizeof(uint32_t) + 1) // Key length and type.
+
+/// @brief Returns the key length of the record at `off`.
+static uint32_t rec_klen(const DictCompact *dict, uint32_t off){
+    return read_u32(dict->pool + off);
+}
+
+/// @brief Returns the type of the record at `off`.
+static DictType rec_type(const DictCompact *dict, uint32_t off){
+    return (DictType)(unsigned char)dict->pool[off + sizeof(uint32_t)];
+}
+
+/// @brief Returns the null-terminated key of the record at `off`.
+static char *rec_key(const DictCompact *dict, uint32_t off){
+    return dict->pool + off + REC_HEADER;
+}
+
+/// @brief Returns the raw value of the record at `off`.
+static char *rec_val(const DictCompact *dict, uint32_t off){
+    return rec_key(dict, off) + rec_klen(dict, off) + 1;
+}
+
+/// @brief Returns the number of bytes a value takes in a record.
+/// @param type Type of the value
+/// @param slen String length, without terminator (ignored for numbers)
+static uint32_t val_size(DictType type, uint32_t slen){
+    switch (type) {
+    case DICT_TYPE_INT:
+        return sizeof(int);
+    case DICT_TYPE_DOUBLE:
+        return sizeof(double);
+    case DICT_TYPE_STRING:
+        return sizeof(uint32_t) + slen + 1;
+    }
+    return 0;
+}
+
+/// @brief Returns the number of live bytes of the record at `off`.
+static uint32_t rec_size(const DictCompact *dict, uint32_t off){
+    DictType type = rec_type(dict, off);
+    uint32_t slen = type == DICT_TYPE_STRING ? read_u32(rec_val(dict, off)) : 0;
+    return REC_HEADER + rec_klen(dict, off) + 1 + val_size(type, slen);
+}
+
+/// @brief Returns the 7-bit tag stored in the control byte of a full slot.
+static uint8_t hash_tag(uint64_t hash){
+    return DICTC_CTRL_FULL | (uint8_t)(hash >> 57);
+}
+
+/// @brief Finds the slot storing `key` or, if missing, the empty slot where it would go.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param key Key string (must not be NULL)
+/// @param found Set to 1 if the key is stored in the returned slot, 0 otherwise
+/// @param tagp Set to the control byte of `key`, so an insert needs no second hash (can be NULL)
+/// @return Slot index, always valid: the table is never full of slots
+static uint32_t find_slot(const DictCompact *dict, const char *key, int *found, uint8_t *tagp){
+    uint64_t hash = hash_fnv1a(key);
+    uint8_t tag = hash_tag(hash);
+    if(tagp != NULL)
+        *tagp = tag;
+    uint32_t klen = strlen(key);
+    uint32_t slot = hash & dict->mask;
+
+    *found = 0;
+    while(dict->ctrl[slot] != DICTC_CTRL_EMPTY){
+        uint32_t off = dict->offs[slot];
+        if(dict->ctrl[slot] == tag && rec_klen(dict, off) == klen
+           && memcmp(rec_key(dict, off), key, klen) == 0){
+            *found = 1;
+            return slot;
+        }
+        slot = (slot + 1) & dict->mask;
+    }
+
+    return slot;
+}
+
+/// @brief Makes room for `n` more bytes at the end of the pool.
+/// @return 1 on success, 0 on failure
+static int pool_reserve(DictCompact *dict, uint32_t n){
+    if(n > UINT32_MAX - dict->pool_len)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    uint32_t need = dict->pool_len + n;
+    if(need <= dict->pool_cap)
+        return 1;
+
+    uint64_t cap = dict->pool_cap ? dict->pool_cap : DICTC_POOL_CAP;
+    while(cap < need)
+        cap *= 2;
+    if(cap > UINT32_MAX)
+        cap = UINT32_MAX;
+
+    char *pool = realloc(dict->pool, cap);
+    if(pool == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    dict->pool = pool;
+    dict->pool_cap = cap;
+
+    return 1;
+}
+
+/// @brief Appends a record at the end of the pool.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param key Key string, can point into the pool only if the room for the
+///        record was already reserved
+/// @param item Value to store, its string must not point into the pool
+/// @return Offset of the record on success, UINT32_MAX otherwise
+static uint32_t append_record(DictCompact *dict, const char *key, const DictValue *item){
+    uint32_t klen = strlen(key);
+    uint32_t slen = item->type == DICT_TYPE_STRING ? strlen(item->s) : 0;
+    if(!pool_reserve(dict, REC_HEADER + klen + 1 + val_size(item->type, slen)))
+        return UINT32_MAX;
+
+    uint32_t off = dict->pool_len;
+    char *p = dict->pool + off;
+
+    write_u32(p, klen);
+    p[sizeof(uint32_t)] = (char)item->type;
+    p += REC_HEADER;
+    memcpy(p, key, klen + 1);
+    p += klen + 1;
+
+    switch (item->type) {
+    case DICT_TYPE_INT:
+        memcpy(p, &item->i, sizeof(int));
+        break;
+    case DICT_TYPE_DOUBLE:
+        memcpy(p, &item->d, sizeof(double));
+        break;
+    case DICT_TYPE_STRING:
+        write_u32(p, slen);
+        memcpy(p + sizeof(uint32_t), item->s, slen + 1);
+        break;
+    }
+
+    dict->pool_len += REC_HEADER + klen + 1 + val_size(item->type, slen);
+
+    return off;
+}
+
+/// @brief Rewrites the pool with live records only, if dead ones waste over half of it.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @note Failing to allocate the new pool is not an error: it is retried later
+static void pool_compact(DictCompact *dict){
+    if(dict->pool_len < DICTC_POOL_CAP || dict->garbage * 2 < dict->pool_len)
+        return;
+
+    uint32_t len = dict->pool_len - dict->garbage;
+    char *pool = malloc(len ? len : 1);
+    if(pool == NULL)
+        return;
+
+    uint32_t pos = 0;
+    for(uint32_t slot = 0; slot <= dict->mask; slot++){
+        if(dict->ctrl[slot] == DICTC_CTRL_EMPTY)
+            continue;
+
+        uint32_t off = dict->offs[slot];
+        uint32_t size = rec_size(dict, off);
+        memcpy(pool + pos, dict->pool + off, size);
+        dict->offs[slot] = pos;
+        pos += size;
+    }
+    assert(pos == len);
+
+    free(dict->pool);
+    dict->pool = pool;
+    dict->pool_len = len;
+    dict->pool_cap = len ? len : 1;
+    dict->garbage = 0;
+}
+
+/// @brief Empties a slot, shifting back the following slots of its probe run.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param hole Slot to empty
+/// @note Rehashes the key of every slot it visits to find its home: records
+///       keep no hash to stay small, and at load <= 4/5 probe runs are short
+static void remove_slot(DictCompact *dict, uint32_t hole){
+    uint32_t slot = hole;
+    for(;;){
+        slot = (slot + 1) & dict->mask;
+        if(dict->ctrl[slot] == DICTC_CTRL_EMPTY)
+            break;
+
+        uint32_t home = hash_fnv1a(rec_key(dict, dict->offs[slot])) & dict->mask;
+        if(!backshift_keeps(home, hole, slot)){
+            dict->ctrl[hole] = dict->ctrl[slot];
+            dict->offs[hole] = dict->offs[slot];
+            hole = slot;
+        }
+    }
+
+    dict->ctrl[hole] = DICTC_CTRL_EMPTY;
+}
+
+/// @brief Internal function to insert a key-value pair into the dictionary.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param key Key string (must not be NULL)
+/// @param item Value to insert (must not be NULL)
+/// @return 1 on success, 0 on failure
+static int dict_compact_put(DictCompact *dict, char *key, const DictValue *item){
+    int found;
+    uint8_t tag;
+    uint32_t slot = find_slot(dict, key, &found, &tag);
+    if(found)
+        SET_ERROR_AND_RETURN(DICT_ERR_ALR_INSERTED, 0);
+    if(dict->size == dict->capacity)
+        SET_ERROR_AND_RETURN(DICT_ERR_DICT_FULL, 0);
+
+    uint32_t off = append_record(dict, key, item);
+    if(off == UINT32_MAX)
+        return 0;
+
+    dict->ctrl[slot] = tag;
+    dict->offs[slot] = off;
+    dict->size++;
+
+    return 1;
+}
+
+/// @brief Finds the record of `key` and checks its type.
+/// @param dict Dictionary pointer (must not be NULL)
+/// @param key Key string (must not be NULL)
+/// @param type Expected type of the value
+/// @return Slot of the record on success, UINT32_MAX otherwise
+static uint32_t get_typed_slot(DictCompact *dict, char *key, DictType type){
+    int found;
+    uint32_t slot = find_slot(dict, key, &found, NULL);
+    if(!found)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOT_FOUND, UINT32_MAX);
+    if(rec_type(dict, dict->offs[slot]) != type)
+        SET_ERROR_AND_RETURN(DICT_ERR_MIS_TYPE, UINT32_MAX);
+
+    return slot;
+}
+
+/// @brief Deep-copies the value of the record at `off` into `out`.
+/// @return 1 on success, 0 on failure
+static int read_value(DictCompact *dict, uint32_t off, DictValue *out){
+    char *p = rec_val(dict, off);
+    DictType type = rec_type(dict, off);
+
+    switch (type) {
+    case DICT_TYPE_INT:
+        memcpy(&out->i, p, sizeof(int));
+        break;
+    case DICT_TYPE_DOUBLE:
+        memcpy(&out->d, p, sizeof(double));
+        break;
+    case DICT_TYPE_STRING: {
+        uint32_t slen = read_u32(p);
+        char *s = malloc(slen + 1);
+        if(s == NULL)
+            SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+        memcpy(s, p + sizeof(uint32_t), slen + 1);
+        out->s = s;
+        break;
+    }
+    }
+    out->type = type;
+
+    return 1;
+}
+
+/* ========== API IMPLEMENTATIONS ========== */
+
+/**
+ * Creates a new compact dictionary with a fixed capacity.
+ *
+ * @param capacity Number of entries the dictionary can hold (must be > 0
+ *        and <= UINT32_MAX / 4, so slot indexes fit in 32 bits)
+ * @return Pointer to newly created DictCompact on success, NULL on failure
+ *
+ * @note Allocates 5 bytes per slot, with at least capacity * 5/4 slots
+ *       rounded up to a power of two; the record pool grows on demand
+ * @note Caller owns the returned dictionary and must free it with dict_compact_destroy()
+ * @example
+ *   DictCompact *d = dict_compact_create(10000000);
+ */
+DictCompact *dict_compact_create(uint32_t capacity){
+    dict_clear_error();
+    if(capacity == 0 || capacity > (UINT32_MAX >> 2))
+        SET_ERROR_AND_RETURN(DICT_ERR_INVALID_CAPACITY, NULL);
+
+    DictCompact *d = calloc(1, sizeof(*d));
+    if(d == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+
+    // Keep load factor under 4/5 so probe runs stay short.
+    uint32_t slots = 1;
+    while(slots < capacity + capacity / 4 + 1)
+        slots <<= 1;
+
+    d->capacity = capacity;
+    d->mask = slots - 1;
+    d->ctrl = calloc(slots, sizeof(uint8_t));
+    d->offs = malloc(slots * sizeof(uint32_t));
+    if(d->ctrl == NULL || d->offs == NULL){
+        dict_compact_destroy(d);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+
+    return d;
+}
+
+/**
+ * Inserts an integer value into the dictionary.
+ *
+ * @param dict Dictionary to insert into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param val Integer value to store
+ * @return 1 on success, 0 on failure
+ *
+ * @note The key and the value are stored in the record pool
+ */
+int dict_compact_put_int(DictCompact *dict, char *key, int val){
+    dict_clear_error();
+    if(dict == NULL || key == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    DictValue dval = { .type = DICT_TYPE_INT, .i = val };
+    return dict_compact_put(dict, key, &dval);
+}
+
+/**
+ * Inserts a double value into the dictionary.
+ *
+ * @param dict Dictionary to insert into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param val Double value to store
+ * @return 1 on success, 0 on failure
+ *
+ * @note The key and the value are stored in the record pool
+ */
+int dict_compact_put_double(DictCompact *dict, char *key, double val){
+    dict_clear_error();
+    if(dict == NULL || key == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    DictValue dval = { .type = DICT_TYPE_DOUBLE, .d = val };
+    return dict_compact_put(dict, key, &dval);
+}
+
+/**
+ * Inserts a string value into the dictionary.
+ *
+ * @param dict Dictionary to insert into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param val Value string to store (must not be NULL, null-terminated)
+ * @return 1 on success, 0 on failure
+ *
+ * @note The key and the value are copied in the record pool
+ */
+int dict_compact_put_string(DictCompact *dict, char *key, char *val){
+    dict_clear_error();
+    if(dict == NULL || key == NULL || val == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    DictValue dval = { .type = DICT_TYPE_STRING, .s = val };
+    return dict_compact_put(dict, key, &dval);
+}
+
+/**
+ * Update existing entry with new value.
+ *
+ * @param dict Dictionary to update into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param val Integer value to update
+ * @return 1 on success, 0 on failure
+ *
+ * @note Type between old value and new value must be the same.
+ */
+int dict_compact_upd_int(DictCompact *dict, char *key, int val){
+    dict_clear_error();
+    if(dict == NULL || key == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    uint32_t slot = get_typed_slot(dict, key, DICT_TYPE_INT);
+    if(slot == UINT32_MAX) return 0;
+
+    memcpy(rec_val(dict, dict->offs[slot]), &val, sizeof(int));
+
+    return 1;
+}
+
+/**
+ * Update existing entry with new value.
+ *
+ * @param dict Dictionary to update into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param val Double value to update
+ * @return 1 on success, 0 on failure
+ *
+ * @note Type between old value and new value must be the same.
+ */
+int dict_compact_upd_double(DictCompact *dict, char *key, double val){
+    dict_clear_error();
+    if(dict == NULL || key == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    uint32_t slot = get_typed_slot(dict, key, DICT_TYPE_DOUBLE);
+    if(slot == UINT32_MAX) return 0;
+
+    memcpy(rec_val(dict, dict->offs[slot]), &val, sizeof(double));
+
+    return 1;
+}
+
+/**
+ * Update existing entry with new value.
+ *
+ * @param dict Dictionary to update into (must not be NULL)
+ * @param key Key string (must not be NULL, null-terminated)
+ * @param val String value to update
+ * @return 1 on success, 0 on failure
+ *
+ * @note Type between old value and new value must be the same.
+ * @note A value not longer than the old one is written in place, a longer
+ *       one moves the record to the end of the pool
+ */
+int dict_compact_upd_string(DictCompact *dict, char *key, char *val){
+    dict_clear_error();
+    if(dict == NULL || key == NULL || val == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    uint32_t slot = get_typed_slot(dict, key, DICT_TYPE_STRING);
+    if(slot == UINT32_MAX) return 0;
+
+    uint32_t off = dict->offs[slot];
+    char *p = rec_val(dict, off);
+    uint32_t old_len = read_u32(p);
+    uint32_t new_len = strlen(val);
+
+    if(new_len <= old_len){
+        memmove(p + sizeof(uint32_t), val, new_len + 1);
+        write_u32(p, new_len);
+        dict->garbage += old_len - new_len;
+        return 1;
+    }
+
+    // The record moves: reserve first, so the old key stays valid while copied.
+    uint32_t klen = rec_klen(dict, off);
+    if(!pool_reserve(dict, REC_HEADER + klen + 1 + val_size(DICT_TYPE_STRING, new_len)))
+        return 0;
+
+    uint32_t dead = rec_size(dict, off);
+    DictValue dval = { .type = DICT_TYPE_STRING, .s = val };
+    dict->offs[slot] = append_record(dict, rec_key(dict, off), &dval);
+    assert(dict->offs[slot] != UINT32_MAX);
+    dict->garbage += dead;
+    pool_compact(dict);
+
+    return 1;
+}
+
+/**
+ * Retrieves a value from the dictionary without removing it.
+ *
+ * @param dict Dictionary to search (must not be NULL)
+ * @param key Key to look up (must not be NULL, null-terminated)
+ * @param out Output parameter for the value (must not be NULL)
+ * @return 1 if key found and out written, 0 otherwise
+ *
+ * @note For DICT_TYPE_STRING, caller must free out->s after use
+ * @note If key not found or error occurs, out is NOT modified
+ */
+int dict_compact_get(DictCompact *dict, char *key, DictValue *out){
+    dict_clear_error();
+    if(dict == NULL || key == NULL || out == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    int found;
+    uint32_t slot = find_slot(dict, key, &found, NULL);
+    if(!found)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOT_FOUND, 0);
+
+    return read_value(dict, dict->offs[slot], out);
+}
+
+/**
+ * Retrieves and removes a value from the dictionary.
+ *
+ * @param dict Dictionary to operate on (must not be NULL)
+ * @param key Key to remove (must not be NULL, null-terminated)
+ * @param out Output parameter for the value (must not be NULL)
+ * @return 1 if key found, removed, and out written; 0 otherwise
+ *
+ * @note For DICT_TYPE_STRING, caller must free out->s after use
+ * @note If key not found or error occurs, out is NOT modified
+ */
+int dict_compact_take(DictCompact *dict, char *key, DictValue *out){
+    dict_clear_error();
+    if(dict == NULL || key == NULL || out == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    int found;
+    uint32_t slot = find_slot(dict, key, &found, NULL);
+    if(!found)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOT_FOUND, 0);
+
+    uint32_t off = dict->offs[slot];
+    if(!read_value(dict, off, out))
+        return 0;
+
+    dict->garbage += rec_size(dict, off);
+    remove_slot(dict, slot);
+    dict->size--;
+    pool_compact(dict);
+
+    return 1;
+}
+
+/**
+ * Removes all entries from the dictionary.
+ *
+ * @param dict Dictionary to clear (can be NULL)
+ *
+ * @note The slots and the record pool stay allocated for reuse
+ * @note This function does not set error state
+ */
+void dict_compact_cleanup(DictCompact *dict){
+    if(dict == NULL) return;
+
+    memset(dict->ctrl, DICTC_CTRL_EMPTY, (size_t)dict->mask + 1);
+    dict->size = 0;
+    dict->pool_len = 0;
+    dict->garbage = 0;
+}
+
+/**
+ * Destroys the dictionary and releases all resources.
+ *
+ * @param dict Dictionary to destroy (can be NULL)
+ *
+ * @note After this call, the dict pointer is INVALID and must not be used
+ * @note This function does not set error state
+ */
+void dict_compact_destroy(DictCompact *dict){
+    if(dict == NULL) return;
+
+    free(dict->ctrl);
+    free(dict->offs);
+    free(dict->pool);
+    free(dict);
+}
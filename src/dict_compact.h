@@ -0,0 +1,50 @@
+#ifndef DICT_COMPACT_H
+#define DICT_COMPACT_H
+#include <stddef.h>
+#include <stdint.h>
+#include "dict.h"
+
+/* ====== Compact dictionary constants. ====== */
+#define DICTC_CTRL_EMPTY 0x00 // Control byte of an empty slot.
+#define DICTC_CTRL_FULL 0x80 // Set on the control byte of a used slot.
+#define DICTC_POOL_CAP 4096 // Initial size of the record pool, in bytes.
+
+/* ====== Compact dictionary struct ====== */
+
+/* A dictionary tuned for memory, for large tables of small entries.
+ * Each slot costs a 1-byte control (empty or 7-bit hash tag) and a 32-bit
+ * offset; keys and values live unboxed in one packed pool of records:
+ *
+ *     [u32 key len][u8 type][key \0][i32 | f64 | u32 len, string \0]
+ *
+ * Collisions are resolved with linear probing and backward-shift deletion.
+ * Records left dead by take and update are reclaimed by compacting the pool. */
+typedef struct {
+    uint32_t size; // How many items are actualy storing.
+    uint32_t capacity; // How many items can store.
+    uint32_t mask; // Number of slots - 1, slots are a power of two.
+
+    uint8_t *ctrl; // Control byte of each slot.
+    uint32_t *offs; // Offset of the record of each slot in pool.
+
+    char *pool; // Packed records.
+    uint32_t pool_len; // Bytes used in pool, dead records included.
+    uint32_t pool_cap; // Bytes allocated for pool.
+    uint32_t garbage; // Bytes of dead records in pool.
+} DictCompact;
+
+/* ====== Compact dictionary API ====== */
+
+DictCompact *dict_compact_create(uint32_t capacity);
+int dict_compact_put_int(DictCompact *dict, char *key, int val);
+int dict_compact_put_double(DictCompact *dict, char *key, double val);
+int dict_compact_put_string(DictCompact *dict, char *key, char *val);
+int dict_compact_upd_int(DictCompact *dict, char *key, int val);
+int dict_compact_upd_double(DictCompact *dict, char *key, double val);
+int dict_compact_upd_string(DictCompact *dict, char *key, char *val);
+int dict_compact_take(DictCompact *dict, char *key, DictValue *out);
+int dict_compact_get(DictCompact *dict, char *key, DictValue *out);
+void dict_compact_cleanup(DictCompact *dict);
+void dict_compact_destroy(DictCompact *dict);
+
+#endif
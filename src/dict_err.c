@@ -28,9 +28,15 @@ const char *dict_error_string(DictError err) {
         case DICT_ERR_NOT_FOUND:
             return "Key not found";
         case DICT_ERR_INVALID_CAPACITY:
-            return "Invalid capacity (must be > 0)";
+            return "Invalid capacity (must be > 0 and not too large)";
         case DICT_ERR_DICT_FULL:
             return "Dictionary is full - no more insertion";
+        case DICT_ERR_NO_INDEX:
+            return "Dictionary has no secondary index";
+        case DICT_ERR_IO:
+            return "I/O error on file descriptor";
+        case DICT_ERR_BAD_FORMAT:
+            return "Malformed record";
         default:
             return "Unknown error";
     }
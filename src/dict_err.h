@@ -8,7 +8,10 @@ typedef enum {
     DICT_ERR_ALR_INSERTED,    // Key already inserted
     DICT_ERR_NOT_FOUND,       // Key not found
     DICT_ERR_DICT_FULL,       // Dict is full
-    DICT_ERR_INVALID_CAPACITY // Capacity = 0 in dict_create
+    DICT_ERR_INVALID_CAPACITY, // Capacity = 0, or too large for dict_compact_create
+    DICT_ERR_NO_INDEX,        // Range query on a dict without secondary index
+    DICT_ERR_IO,              // read/write on a file descriptor failed (see errno)
+    DICT_ERR_BAD_FORMAT       // Malformed record in import, or value not exportable
 } DictError;
 
 extern _Thread_local DictError g_last_error;
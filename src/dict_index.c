@@ -0,0 +1,296 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "dict_index.h"
+#include "dict_err.h"
+
+/* ========== PRIVATE HELPERS ========== */
+
+/// @brief qsort comparator over arrays of strings.
+static int cmp_keys(const void *a, const void *b){
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/// @brief Makes room for at least `n` sorted keys.
+/// @param idx Index pointer (must not be NULL)
+/// @param n Number of keys to fit
+/// @return 1 on success, 0 on failure
+static int index_reserve(DictIndex *idx, uint32_t n){
+    if(n <= idx->cap)
+        return 1;
+
+    uint32_t cap = idx->cap ? idx->cap : DICT_INDEX_BATCH;
+    while(cap < n)
+        cap *= 2;
+
+    char **keys = realloc(idx->keys, cap * sizeof(char*));
+    if(keys == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+    idx->keys = keys;
+
+    // cap is a multiple of DICT_INDEX_BATCH, so of 64.
+    uint64_t *dead = realloc(idx->dead, cap / 64 * sizeof(uint64_t));
+    if(dead == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+    memset(dead + idx->cap / 64, 0, (cap - idx->cap) / 64 * sizeof(uint64_t));
+    idx->dead = dead;
+
+    idx->cap = cap;
+
+    return 1;
+}
+
+/// @brief Marks the sorted key at `pos` as removed (1) or live (0).
+static void set_dead(DictIndex *idx, uint32_t pos, int dead){
+    uint64_t bit = (uint64_t)1 << (pos % 64);
+    if(dead)
+        idx->dead[pos / 64] |= bit;
+    else
+        idx->dead[pos / 64] &= ~bit;
+}
+
+/// @brief Drops every dead key, keeping the others sorted.
+/// @param idx Index pointer (must not be NULL)
+static void index_compact(DictIndex *idx){
+    if(idx->ndead == 0)
+        return;
+
+    uint32_t live = 0;
+    for(uint32_t i = 0; i < idx->len; i++){
+        if(index_is_dead(idx, i))
+            free(idx->keys[i]);
+        else
+            idx->keys[live++] = idx->keys[i];
+    }
+
+    memset(idx->dead, 0, (idx->len + 63) / 64 * sizeof(uint64_t));
+    idx->len = live;
+    idx->ndead = 0;
+}
+
+/* ========== API IMPLEMENTATIONS ========== */
+
+/**
+ * Creates an index holding a copy of `keys`.
+ * 
+ * @param keys Keys to index, in any order (can be NULL if n is 0)
+ * @param n Number of keys
+ * @return Pointer to newly created index on success, NULL on failure
+ * 
+ * @note Costs a single O(n log n) sort, not n batched insertions
+ */
+DictIndex *index_create(const char **keys, uint32_t n){
+    DictIndex *idx = calloc(1, sizeof(*idx));
+    if(idx == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+
+    if(!index_reserve(idx, n)){
+        free(idx);
+        return NULL;
+    }
+
+    for(uint32_t i = 0; i < n; i++){
+        idx->keys[i] = strdup(keys[i]);
+        if(idx->keys[i] == NULL){
+            index_destroy(idx);
+            SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+        }
+        idx->len++;
+    }
+    if(idx->len > 1)
+        qsort(idx->keys, idx->len, sizeof(char*), cmp_keys);
+
+    return idx;
+}
+
+/**
+ * Adds a copy of `key` to the index.
+ * 
+ * @param idx Index pointer (must not be NULL)
+ * @param key Key not yet indexed (must not be NULL)
+ * @return 1 on success, 0 on failure
+ * 
+ * @note The key is only buffered, a full buffer is merged first
+ * @note A key removed but not yet dropped is revived in place
+ */
+int index_add(DictIndex *idx, const char *key){
+    assert(idx != NULL);
+    assert(key != NULL);
+
+    if(idx->ndead > 0){
+        uint32_t pos = index_lower_bound(idx, key);
+        if(pos < idx->len && index_is_dead(idx, pos) && strcmp(idx->keys[pos], key) == 0){
+            set_dead(idx, pos, 0);
+            idx->ndead--;
+            return 1;
+        }
+    }
+
+    if(idx->npending == DICT_INDEX_BATCH && !index_flush(idx))
+        return 0;
+
+    char *dup = strdup(key);
+    if(dup == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    idx->pending[idx->npending++] = dup;
+
+    return 1;
+}
+
+/**
+ * Removes `key` from the index, if present.
+ * 
+ * @param idx Index pointer (must not be NULL)
+ * @param key Key to remove (must not be NULL)
+ * 
+ * @note A sorted key is only marked dead, so removing costs O(log n)
+ */
+void index_remove(DictIndex *idx, const char *key){
+    assert(idx != NULL);
+    assert(key != NULL);
+
+    for(uint32_t i = 0; i < idx->npending; i++){
+        if(strcmp(idx->pending[i], key) == 0){
+            free(idx->pending[i]);
+            idx->pending[i] = idx->pending[--idx->npending];
+            return;
+        }
+    }
+
+    uint32_t pos = index_lower_bound(idx, key);
+    if(pos == idx->len || index_is_dead(idx, pos) || strcmp(idx->keys[pos], key) != 0)
+        return;
+
+    set_dead(idx, pos, 1);
+    idx->ndead++;
+
+    // Amortized O(1): a compaction pays for the len / 2 removals before it.
+    if(idx->ndead * 2 > idx->len)
+        index_compact(idx);
+}
+
+/**
+ * Merges the buffered keys into the sorted ones, dropping dead keys.
+ * 
+ * @param idx Index pointer (must not be NULL)
+ * @return 1 on success, 0 on failure
+ * 
+ * @note Dropping dead keys costs O(len), paid for by the removals that
+ *       marked them: a flush with no removal before it only merges
+ */
+int index_flush(DictIndex *idx){
+    assert(idx != NULL);
+
+    index_compact(idx);
+    if(idx->npending == 0)
+        return 1;
+
+    if(!index_reserve(idx, idx->len + idx->npending))
+        return 0;
+
+    qsort(idx->pending, idx->npending, sizeof(char*), cmp_keys);
+
+    // Merge from the back, so no temporary array is needed.
+    uint32_t i = idx->len, j = idx->npending, k = idx->len + idx->npending;
+    while(j > 0){
+        if(i > 0 && strcmp(idx->keys[i - 1], idx->pending[j - 1]) > 0)
+            idx->keys[--k] = idx->keys[--i];
+        else
+            idx->keys[--k] = idx->pending[--j];
+    }
+
+    idx->len += idx->npending;
+    idx->npending = 0;
+
+    return 1;
+}
+
+/**
+ * Checks whether the sorted key at `pos` was removed.
+ * 
+ * @param idx Index pointer (must not be NULL)
+ * @param pos Position in idx->keys (must be < idx->len)
+ * @return 1 if the key is dead, 0 otherwise
+ */
+int index_is_dead(const DictIndex *idx, uint32_t pos){
+    assert(pos < idx->len);
+    return (idx->dead[pos / 64] >> (pos % 64)) & 1;
+}
+
+/**
+ * Finds the first sorted key not less than `key`.
+ * 
+ * @param idx Index pointer (must not be NULL)
+ * @param key Key to search (must not be NULL)
+ * @return Position in idx->keys, idx->len if every key is less than `key`
+ * 
+ * @note Buffered keys are not searched, call index_flush() first
+ * @note Dead keys are searched too, check index_is_dead()
+ */
+uint32_t index_lower_bound(DictIndex *idx, const char *key){
+    uint32_t lo = 0, hi = idx->len;
+    while(lo < hi){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(strcmp(idx->keys[mid], key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Finds the end of the run of keys starting with `prefix`.
+ * 
+ * @param idx Index pointer (must not be NULL)
+ * @param from Position returned by index_lower_bound(idx, prefix)
+ * @param prefix Prefix to search (must not be NULL)
+ * @return Position of the first sorted key, after `from`, not starting with `prefix`
+ */
+uint32_t index_prefix_end(DictIndex *idx, uint32_t from, const char *prefix){
+    size_t plen = strlen(prefix);
+    uint32_t lo = from, hi = idx->len;
+    while(lo < hi){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(strncmp(idx->keys[mid], prefix, plen) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Removes every key from the index.
+ * 
+ * @param idx Index pointer (can be NULL)
+ */
+void index_clear(DictIndex *idx){
+    if(idx == NULL) return;
+
+    for(uint32_t i = 0; i < idx->len; i++)
+        free(idx->keys[i]);
+    for(uint32_t i = 0; i < idx->npending; i++)
+        free(idx->pending[i]);
+
+    if(idx->dead != NULL)
+        memset(idx->dead, 0, idx->cap / 64 * sizeof(uint64_t));
+    idx->len = 0;
+    idx->npending = 0;
+    idx->ndead = 0;
+}
+
+/**
+ * Destroys the index and every key it holds.
+ * 
+ * @param idx Index pointer (can be NULL)
+ */
+void index_destroy(DictIndex *idx){
+    if(idx == NULL) return;
+
+    index_clear(idx);
+    free(idx->keys);
+    free(idx->dead);
+    free(idx);
+}
@@ -0,0 +1,39 @@
+#ifndef DICT_INDEX_H
+#define DICT_INDEX_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* ====== Secondary index constants. ====== */
+#define DICT_INDEX_BATCH 256 // Insertions buffered before a merge.
+
+/* ====== Secondary index struct ====== */
+
+/* Ordered set of the keys of a dictionary.
+ * Insertions are buffered unsorted in `pending` and merged into `keys`
+ * in batches, so a merge costs O(len) once every DICT_INDEX_BATCH keys.
+ * Removals only mark the sorted key in `dead`; dead keys are dropped by
+ * the next flush, or once they are half of the sorted keys. */
+typedef struct DictIndex {
+    uint32_t len; // How many keys are sorted, dead ones included.
+    uint32_t cap; // How many keys can be sorted without reallocating.
+    uint32_t npending; // How many keys are waiting to be merged.
+    uint32_t ndead; // How many sorted keys are removed.
+
+    char **keys; // Sorted keys, owned by the index.
+    uint64_t *dead; // One bit per sorted key, set if the key was removed.
+    char *pending[DICT_INDEX_BATCH]; // Unsorted keys, owned by the index.
+} DictIndex;
+
+/* ====== Secondary index API ====== */
+
+DictIndex *index_create(const char **keys, uint32_t n);
+int index_add(DictIndex *idx, const char *key);
+void index_remove(DictIndex *idx, const char *key);
+int index_flush(DictIndex *idx);
+int index_is_dead(const DictIndex *idx, uint32_t pos);
+uint32_t index_lower_bound(DictIndex *idx, const char *key);
+uint32_t index_prefix_end(DictIndex *idx, uint32_t from, const char *prefix);
+void index_clear(DictIndex *idx);
+void index_destroy(DictIndex *idx);
+
+#endif
@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "hash.h"
+#include "utils.h"
+#include "dict_intern.h"
+#include "dict_err.h"
+
+/* ========== PRIVATE HELPERS ========== */
+
+/// @brief Recovers the interned string header from its data pointer.
+/// @param str Data pointer returned by strpool_intern (must not be NULL)
+/// @return Header of the interned string
+static DictIStr *istr_of(char *str){
+    assert(str != NULL);
+    return (DictIStr *)(str - offsetof(DictIStr, data));
+}
+
+/// @brief Doubles the pool capacity, rehashing every string.
+/// @param pool Pool pointer (must not be NULL)
+/// @return 1 on success, 0 on failure
+static int strpool_grow(DictStrPool *pool){
+    if(pool->capacity > UINT32_MAX / 2)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    uint32_t capacity = pool->capacity * 2;
+    DictIStr **slots = calloc(capacity, sizeof(DictIStr*));
+    if(slots == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    for(uint32_t i = 0; i < pool->capacity; i++){
+        DictIStr *s = pool->slots[i];
+        if(s == NULL)
+            continue;
+
+        uint32_t cell = s->hash & (capacity - 1);
+        while(slots[cell] != NULL)
+            cell = (cell + 1) & (capacity - 1);
+        slots[cell] = s;
+    }
+
+    free(pool->slots);
+    pool->slots = slots;
+    pool->capacity = capacity;
+
+    return 1;
+}
+
+/* ========== API IMPLEMENTATIONS ========== */
+
+/**
+ * Creates an empty pool of interned strings.
+ * 
+ * @return Pointer to newly created pool with refcount 1, NULL on failure
+ * 
+ * @note Caller must drop its reference with strpool_unref()
+ */
+DictStrPool *strpool_create(void){
+    DictStrPool *pool = malloc(sizeof(*pool));
+    if(pool == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+
+    atomic_init(&pool->refcount, 1);
+    pool->size = 0;
+    pool->capacity = STRPOOL_CAP;
+    pool->slots = calloc(pool->capacity, sizeof(DictIStr*));
+    if(pool->slots == NULL){
+        free(pool);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+    if(pthread_mutex_init(&pool->lock, NULL) != 0){
+        free(pool->slots);
+        free(pool);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+
+    return pool;
+}
+
+/**
+ * Returns the interned copy of `str`, taking a new reference on it.
+ * 
+ * @param pool Pool to intern into (must not be NULL)
+ * @param str String to intern (must not be NULL, null-terminated)
+ * @return Immutable shared string on success, NULL on failure
+ * 
+ * @note Equal strings always return the same pointer, so two interned
+ *       strings of the same pool are equal iff their pointers are equal
+ * @note Every call must be paired with strpool_release()
+ * @note A new string that cannot grow the table fails with DICT_ERR_NOMEM
+ * @note Thread-safe: the pool is shared with clones used by other threads
+ */
+char *strpool_intern(DictStrPool *pool, const char *str){
+    assert(str != NULL);
+    return strpool_intern_n(pool, str, strlen(str));
+}
+
+/**
+ * Returns the interned copy of the first `len` bytes of `str`, as strpool_intern().
+ * 
+ * @param pool Pool to intern into (must not be NULL)
+ * @param str String to intern (must not be NULL, need not be null-terminated)
+ * @param len Bytes of str to intern, none of them '\0'
+ * @return Immutable shared null-terminated string on success, NULL on failure
+ */
+char *strpool_intern_n(DictStrPool *pool, const char *str, size_t len){
+    assert(pool != NULL);
+    assert(str != NULL);
+
+    uint64_t hash = hash_fnv1a_n(str, len);
+    pthread_mutex_lock(&pool->lock);
+
+    uint32_t mask = pool->capacity - 1;
+    uint32_t cell = hash & mask;
+
+    while(pool->slots[cell] != NULL){
+        DictIStr *s = pool->slots[cell];
+        if(s->hash == hash && strncmp(s->data, str, len) == 0 && s->data[len] == '\0'){
+            atomic_fetch_add_explicit(&s->refcount, 1, memory_order_relaxed);
+            pthread_mutex_unlock(&pool->lock);
+            return s->data;
+        }
+        cell = (cell + 1) & mask;
+    }
+
+    // Keep load factor under 3/4 so probe sequences stay short and the
+    // table always has an empty slot to end them.
+    if((pool->size + 1) * 4 > pool->capacity * 3){
+        if(!strpool_grow(pool)){
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        mask = pool->capacity - 1;
+        cell = hash & mask;
+        while(pool->slots[cell] != NULL)
+            cell = (cell + 1) & mask;
+    }
+
+    DictIStr *s = malloc(sizeof(*s) + len + 1);
+    if(s == NULL){
+        pthread_mutex_unlock(&pool->lock);
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, NULL);
+    }
+
+    atomic_init(&s->refcount, 1);
+    s->hash = hash;
+    memcpy(s->data, str, len);
+    s->data[len] = '\0';
+    pool->slots[cell] = s;
+    pool->size++;
+
+    pthread_mutex_unlock(&pool->lock);
+    return s->data;
+}
+
+/**
+ * Takes a new reference on an already interned string.
+ * 
+ * @param str String returned by strpool_intern (must not be NULL)
+ * @return str itself
+ * 
+ * @note No hashing nor lookup: the handle is the string
+ * @note The caller must already own a reference on str
+ */
+char *strpool_ref(char *str){
+    atomic_fetch_add_explicit(&istr_of(str)->refcount, 1, memory_order_relaxed);
+    return str;
+}
+
+/**
+ * Drops one reference to an interned string, freeing it on the last one.
+ * 
+ * @param pool Pool the string was interned into (must not be NULL)
+ * @param str String returned by strpool_intern (must not be NULL)
+ */
+void strpool_release(DictStrPool *pool, char *str){
+    assert(pool != NULL);
+    DictIStr *s = istr_of(str);
+
+    // Decrement under the lock, so strpool_intern() never finds a dying string.
+    pthread_mutex_lock(&pool->lock);
+    if(atomic_fetch_sub_explicit(&s->refcount, 1, memory_order_acq_rel) != 1){
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+
+    uint32_t mask = pool->capacity - 1;
+    uint32_t hole = s->hash & mask;
+    while(pool->slots[hole] != s){
+        assert(pool->slots[hole] != NULL);
+        hole = (hole + 1) & mask;
+    }
+
+    // Shift back every following string whose home is not after the hole.
+    uint32_t cell = hole;
+    for(;;){
+        cell = (cell + 1) & mask;
+        DictIStr *next = pool->slots[cell];
+        if(next == NULL)
+            break;
+
+        uint32_t home = next->hash & mask;
+        if(!backshift_keeps(home, hole, cell)){
+            pool->slots[hole] = next;
+            hole = cell;
+        }
+    }
+
+    pool->slots[hole] = NULL;
+    pool->size--;
+    pthread_mutex_unlock(&pool->lock);
+    free(s);
+}
+
+/**
+ * Drops one reference to the pool, freeing it on the last one.
+ * 
+ * @param pool Pool to release (can be NULL)
+ * 
+ * @note Strings still interned at that point are freed with the pool
+ */
+void strpool_unref(DictStrPool *pool){
+    if(pool == NULL) return;
+    if(atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) != 1)
+        return;
+
+    for(uint32_t i = 0; i < pool->capacity; i++)
+        free(pool->slots[i]);
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->slots);
+    free(pool);
+}
@@ -0,0 +1,41 @@
+#ifndef DICT_INTERN_H
+#define DICT_INTERN_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/* ====== Interned strings constants. ====== */
+#define STRPOOL_CAP 64 // Initial capacity, must be a power of two.
+
+/* ====== Interned strings struct ====== */
+
+/* An immutable string shared by every value equal to it. */
+typedef struct {
+    _Atomic uint32_t refcount; // How many values are pointing to this string.
+    uint64_t hash; // hash_fnv1a of data.
+    char data[];
+} DictIStr;
+
+/* A set of interned strings, shared by a dictionary and all its clones.
+ * Uses linear probing with backward-shift deletion (no tombstones).
+ * Clones may live on other threads, so the table is guarded by `lock`. */
+typedef struct DictStrPool {
+    _Atomic uint32_t refcount; // How many dictionaries are sharing this pool.
+    pthread_mutex_t lock; // Guards size, capacity and slots.
+    uint32_t size; // How many strings are actualy interned.
+    uint32_t capacity; // How many slots are allocated, always a power of two.
+
+    DictIStr **slots; // List of strings.
+} DictStrPool;
+
+/* ====== Interned strings API ====== */
+
+DictStrPool *strpool_create(void);
+char *strpool_intern(DictStrPool *pool, const char *str);
+char *strpool_intern_n(DictStrPool *pool, const char *str, size_t len);
+char *strpool_ref(char *str);
+void strpool_release(DictStrPool *pool, char *str);
+void strpool_unref(DictStrPool *pool);
+
+#endif
@@ -0,0 +1,429 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#include "dict.h"
+#include "utils.h"
+#include "dict_io.h"
+#include "dict_err.h"
+
+/* ========== PRIVATE HELPERS ========== */
+
+/* Buffered writer over a file descriptor. */
+typedef struct {
+    int fd;
+    size_t len; // Bytes waiting in buf.
+    char *buf;
+} DictWriter;
+
+/// @brief Writes all of `data`, retrying on short writes and EINTR.
+/// @return 1 on success, 0 on failure (errno is left as set by write)
+static int write_all(int fd, const char *data, size_t n){
+    while(n > 0){
+        ssize_t w = write(fd, data, n);
+        if(w < 0){
+            if(errno == EINTR)
+                continue;
+            SET_ERROR_AND_RETURN(DICT_ERR_IO, 0);
+        }
+        data += w;
+        n -= w;
+    }
+    return 1;
+}
+
+/// @brief Writes the buffered bytes.
+/// @return 1 on success, 0 on failure
+static int writer_flush(DictWriter *w){
+    if(!write_all(w->fd, w->buf, w->len))
+        return 0;
+    w->len = 0;
+    return 1;
+}
+
+/// @brief Appends `n` bytes to the writer, flushing when the buffer is full.
+/// @return 1 on success, 0 on failure
+static int writer_put(DictWriter *w, const void *data, size_t n){
+    if(w->len + n > DICT_IO_BUF && !writer_flush(w))
+        return 0;
+    if(n > DICT_IO_BUF)
+        return write_all(w->fd, data, n);
+
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+    return 1;
+}
+
+/// @brief Copies a number of a text record into `num`, null-terminated.
+/// @param num Destination, DICT_IO_NUM_MAX bytes
+/// @param val First byte of the number
+/// @param end Byte after the number
+/// @return 1 on success, 0 if the number is too long
+static int copy_num(char *num, const char *val, const char *end){
+    size_t n = end - val;
+    if(n >= DICT_IO_NUM_MAX)
+        SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+
+    memcpy(num, val, n);
+    num[n] = '\0';
+    return 1;
+}
+
+/// @brief Parses and inserts one text record.
+/// @param dict Dictionary to insert into (must not be NULL)
+/// @param line First byte of the record
+/// @param end Byte after the record
+/// @return 1 on success, 0 on failure
+/// @note The record is not modified: key and string value are copied
+///       straight from it by dict_put_n()
+static int load_text_line(Dict *dict, const char *line, const char *end){
+    if(line == end)
+        return 1; // Empty lines are skipped.
+
+    const char *tab = memchr(line, '\t', end - line);
+    if(tab == NULL || end - tab < 3 || tab[2] != ':' || memchr(line, '\0', end - line) != NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+
+    const char *val = tab + 3;
+    char num[DICT_IO_NUM_MAX];
+    char *stop;
+    DictValue item;
+
+    switch (tab[1]) {
+    case 'i': {
+        if(!copy_num(num, val, end))
+            return 0;
+        errno = 0;
+        long n = strtol(num, &stop, 10);
+        if(stop == num || *stop != '\0' || errno != 0 || n < INT_MIN || n > INT_MAX)
+            SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+        item.type = DICT_TYPE_INT;
+        item.i = (int)n;
+        break;
+    }
+    case 'd': {
+        if(!copy_num(num, val, end))
+            return 0;
+        errno = 0;
+        double d = strtod(num, &stop);
+        // ERANGE on underflow still returns the (subnormal) value: keep it.
+        if(stop == num || *stop != '\0' || (errno == ERANGE && (d == HUGE_VAL || d == -HUGE_VAL)))
+            SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+        item.type = DICT_TYPE_DOUBLE;
+        item.d = d;
+        break;
+    }
+    case 's':
+        item.type = DICT_TYPE_STRING;
+        item.s = (char *)val; // Only read by dict_put_n().
+        break;
+    default:
+        SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+    }
+
+    return dict_put_n(dict, line, tab - line, &item, end - val);
+}
+
+/// @brief Inserts every complete text record of `buf`.
+/// @param dict Dictionary to insert into (must not be NULL)
+/// @param buf Records, not modified
+/// @param len Bytes in buf
+/// @param eof 1 if no byte follows buf, so a last line without '\n' is complete
+/// @param used Output parameter for the bytes consumed
+/// @return 1 on success, 0 on failure
+static int load_text(Dict *dict, const char *buf, size_t len, int eof, size_t *used){
+    const char *p = buf, *stop = buf + len;
+
+    const char *nl;
+    while((nl = memchr(p, '\n', stop - p)) != NULL){
+        if(!load_text_line(dict, p, nl))
+            return 0;
+        p = nl + 1;
+    }
+
+    if(eof && p < stop){
+        if(!load_text_line(dict, p, stop))
+            return 0;
+        p = stop;
+    }
+
+    *used = p - buf;
+    return 1;
+}
+
+/// @brief Inserts every complete binary record of `buf`.
+/// @param dict Dictionary to insert into (must not be NULL)
+/// @param buf Records, not modified
+/// @param len Bytes in buf
+/// @param eof 1 if no byte follows buf, so a partial record is an error
+/// @param used Output parameter for the bytes consumed
+/// @return 1 on success, 0 on failure
+static int load_binary(Dict *dict, const char *buf, size_t len, int eof, size_t *used){
+    const char *p = buf, *stop = buf + len;
+
+    while((size_t)(stop - p) >= DICT_IO_REC_HEADER){
+        uint64_t klen = read_u32(p);
+        DictType type = (DictType)(unsigned char)p[4];
+        uint64_t vlen = read_u32(p + 5);
+
+        uint64_t vsize;
+        switch (type) {
+        case DICT_TYPE_INT:
+            vsize = sizeof(int);
+            break;
+        case DICT_TYPE_DOUBLE:
+            vsize = sizeof(double);
+            break;
+        case DICT_TYPE_STRING:
+            vsize = vlen + 1;
+            break;
+        default:
+            SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+        }
+        if(type != DICT_TYPE_STRING && vlen != vsize)
+            SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+
+        uint64_t size = DICT_IO_REC_HEADER + klen + 1 + vsize;
+        if((uint64_t)(stop - p) < size)
+            break;
+
+        const char *key = p + DICT_IO_REC_HEADER;
+        const char *val = key + klen + 1;
+        if(memchr(key, '\0', klen + 1) != key + klen)
+            SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+
+        DictValue item;
+        item.type = type;
+        if(type == DICT_TYPE_INT){
+            memcpy(&item.i, val, sizeof(int));
+        } else if(type == DICT_TYPE_DOUBLE){
+            memcpy(&item.d, val, sizeof(double));
+        } else {
+            if(memchr(val, '\0', vlen + 1) != val + vlen)
+                SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+            item.s = (char *)val; // Only read by dict_put_n().
+        }
+        if(!dict_put_n(dict, key, klen, &item, vlen))
+            return 0;
+
+        p += size;
+    }
+
+    if(eof && p != stop)
+        SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+
+    *used = p - buf;
+    return 1;
+}
+
+/// @brief Inserts every complete record of `buf`, in the given format.
+static int load_records(Dict *dict, const char *buf, size_t len, int eof, size_t *used, DictIOFormat fmt){
+    return fmt == DICT_IO_TEXT ? load_text(dict, buf, len, eof, used)
+                               : load_binary(dict, buf, len, eof, used);
+}
+
+/// @brief Writes one entry as a text record.
+/// @return 1 on success, 0 on failure
+static int dump_text(DictWriter *w, const char *key, const DictValue *val){
+    if(strpbrk(key, "\t\n") != NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+    if(!writer_put(w, key, strlen(key)))
+        return 0;
+
+    char num[40];
+    int n;
+    switch (val->type) {
+    case DICT_TYPE_INT:
+        n = snprintf(num, sizeof(num), "\ti:%d\n", val->i);
+        return writer_put(w, num, n);
+
+    case DICT_TYPE_DOUBLE:
+        n = snprintf(num, sizeof(num), "\td:%.17g\n", val->d);
+        return writer_put(w, num, n);
+
+    case DICT_TYPE_STRING:
+        if(strchr(val->s, '\n') != NULL)
+            SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+        return writer_put(w, "\ts:", 3)
+            && writer_put(w, val->s, strlen(val->s))
+            && writer_put(w, "\n", 1);
+    }
+
+    return 1;
+}
+
+/// @brief Writes one entry as a binary record.
+/// @return 1 on success, 0 on failure
+static int dump_binary(DictWriter *w, const char *key, const DictValue *val){
+    size_t klen = strlen(key);
+    const void *data;
+    size_t vlen;
+
+    switch (val->type) {
+    case DICT_TYPE_INT:
+        data = &val->i;
+        vlen = sizeof(int);
+        break;
+    case DICT_TYPE_DOUBLE:
+        data = &val->d;
+        vlen = sizeof(double);
+        break;
+    case DICT_TYPE_STRING:
+    default:
+        data = val->s;
+        vlen = strlen(val->s);
+        break;
+    }
+    if(klen > UINT32_MAX || vlen > UINT32_MAX)
+        SET_ERROR_AND_RETURN(DICT_ERR_BAD_FORMAT, 0);
+
+    char hdr[DICT_IO_REC_HEADER];
+    write_u32(hdr, klen);
+    hdr[4] = (char)val->type;
+    write_u32(hdr + 5, vlen);
+
+    return writer_put(w, hdr, sizeof(hdr))
+        && writer_put(w, key, klen + 1)
+        && writer_put(w, data, val->type == DICT_TYPE_STRING ? vlen + 1 : vlen);
+}
+
+/* ========== API IMPLEMENTATIONS ========== */
+
+/**
+ * Inserts every record read from a file descriptor until end of file.
+ *
+ * @param dict Dictionary to insert into (must not be NULL)
+ * @param fd File descriptor open for reading
+ * @param fmt Format of the records
+ * @return 1 on success, 0 on failure
+ *
+ * @note Reads DICT_IO_BUF bytes at a time and parses records in place:
+ *       no key or value is copied before being stored in dict
+ * @note Records are inserted as with dict_put_*: an existing key fails
+ *       with DICT_ERR_ALR_INSERTED
+ * @note On failure the records loaded so far stay in dict
+ * @example
+ *   int fd = open("dump.tsv", O_RDONLY);
+ *   if (!dict_load_fd(d, fd, DICT_IO_TEXT)) {
+ *       fprintf(stderr, "Load failed: %s\n",
+ *               dict_error_string(dict_last_error()));
+ *   }
+ */
+int dict_load_fd(Dict *dict, int fd, DictIOFormat fmt){
+    dict_clear_error();
+    if(dict == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    size_t cap = DICT_IO_BUF, have = 0;
+    char *buf = malloc(cap);
+    if(buf == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    for(;;){
+        // A record larger than the buffer: grow it.
+        if(have == cap){
+            char *tmp = realloc(buf, cap * 2);
+            if(tmp == NULL){
+                free(buf);
+                SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+            }
+            buf = tmp;
+            cap *= 2;
+        }
+
+        ssize_t n = read(fd, buf + have, cap - have);
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            free(buf);
+            SET_ERROR_AND_RETURN(DICT_ERR_IO, 0);
+        }
+        have += n;
+
+        size_t used;
+        if(!load_records(dict, buf, have, n == 0, &used, fmt)){
+            free(buf);
+            return 0;
+        }
+        if(n == 0)
+            break;
+
+        memmove(buf, buf + used, have - used);
+        have -= used;
+    }
+
+    free(buf);
+    return 1;
+}
+
+/**
+ * Inserts every record of a memory buffer, such as a mmap'd file.
+ *
+ * @param dict Dictionary to insert into (must not be NULL)
+ * @param buf Records (must not be NULL unless len is 0)
+ * @param len Bytes in buf
+ * @param fmt Format of the records
+ * @return 1 on success, 0 on failure
+ *
+ * @note buf is never modified, so a PROT_READ mapping can be loaded
+ *       as is: only the pages touched by the parser are read in
+ * @note Records are inserted as with dict_put_*: an existing key fails
+ *       with DICT_ERR_ALR_INSERTED
+ */
+int dict_load_buf(Dict *dict, const char *buf, size_t len, DictIOFormat fmt){
+    dict_clear_error();
+    if(dict == NULL || (buf == NULL && len > 0))
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+    if(len == 0)
+        return 1;
+
+    size_t used;
+    return load_records(dict, buf, len, 1, &used, fmt);
+}
+
+/**
+ * Writes every entry of the dictionary to a file descriptor.
+ *
+ * @param dict Dictionary to dump (must not be NULL)
+ * @param fd File descriptor open for writing
+ * @param fmt Format of the records
+ * @return 1 on success, 0 on failure
+ *
+ * @note Records are buffered and written DICT_IO_BUF bytes at a time
+ * @note Dump a dict_clone() to keep writing on the dictionary meanwhile
+ * @note DICT_IO_TEXT fails with DICT_ERR_BAD_FORMAT on keys holding
+ *       '\t' or '\n' and on strings holding '\n'
+ * @example
+ *   Dict *snap = dict_clone(d);
+ *   dict_dump_fd(snap, fd, DICT_IO_BINARY);
+ *   dict_destroy(snap);
+ */
+int dict_dump_fd(Dict *dict, int fd, DictIOFormat fmt){
+    dict_clear_error();
+    if(dict == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NULL_ARG, 0);
+
+    DictWriter w = { .fd = fd, .len = 0, .buf = malloc(DICT_IO_BUF) };
+    if(w.buf == NULL)
+        SET_ERROR_AND_RETURN(DICT_ERR_NOMEM, 0);
+
+    DictIter it;
+    const char *key;
+    const DictValue *val;
+    int res = 1;
+
+    dict_iter_init(dict, &it);
+    while(res && dict_iter_next(&it, &key, &val)){
+        res = fmt == DICT_IO_TEXT ? dump_text(&w, key, val)
+                                  : dump_binary(&w, key, val);
+    }
+    if(res)
+        res = writer_flush(&w);
+
+    free(w.buf);
+    return res;
+}
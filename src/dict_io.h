@@ -0,0 +1,36 @@
+#ifndef DICT_IO_H
+#define DICT_IO_H
+#include <stddef.h>
+#include <stdint.h>
+#include "dict.h"
+
+/* ====== Import/export constants. ====== */
+#define DICT_IO_BUF (1u << 20) // Size of the read and write buffers.
+#define DICT_IO_NUM_MAX 64 // Longest number in a text record, terminator included.
+#define DICT_IO_REC_HEADER 9 // Binary record header: u32 key len, u8 type, u32 value len.
+
+/* ====== Import/export formats ====== */
+
+/* Record formats understood by dict_load_* and dict_dump_fd.
+ *
+ * DICT_IO_TEXT, one record per line:
+ *     key \t i:<int> | d:<double> | s:<string> \n
+ * keys cannot hold '\t' or '\n', strings cannot hold '\n', numbers are
+ * shorter than DICT_IO_NUM_MAX.
+ *
+ * DICT_IO_BINARY, length-prefixed records in host byte order:
+ *     [u32 key len][u8 DictType][u32 value len][key \0][value]
+ * where value is an int, a double or a string followed by \0; lengths do
+ * not count the \0, so records are parsed in place with no copy. */
+typedef enum {
+    DICT_IO_TEXT,
+    DICT_IO_BINARY
+} DictIOFormat;
+
+/* ====== Import/export API ====== */
+
+int dict_load_fd(Dict *dict, int fd, DictIOFormat fmt);
+int dict_load_buf(Dict *dict, const char *buf, size_t len, DictIOFormat fmt);
+int dict_dump_fd(Dict *dict, int fd, DictIOFormat fmt);
+
+#endif
@@ -24,6 +24,15 @@ uint64_t hash_fnv1a(const char *key) {
     return hash;
 }
 
+uint64_t hash_fnv1a_n(const char *key, size_t len) {
+    uint64_t hash = 14695981039346656037ULL; // offset basis
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 1099511628211ULL; // FNV prime
+    }
+    return hash;
+}
+
 uint64_t bad_hash(const char *key) {
     (void)key;
     return 42;
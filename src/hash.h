@@ -7,6 +7,7 @@
 
 /* ====== Avaible hash functions ====== */
 uint64_t hash_fnv1a(const char *key);
+uint64_t hash_fnv1a_n(const char *key, size_t len);
 uint64_t hash_djb2(const char *key);
 uint64_t bad_hash(const char *key);
 uint64_t bad_hash2(const char *key);
@@ -2,10 +2,246 @@
 #include <stdio.h>
 #include <assert.h>
 #include "dict.c"
+#include "dict_compact.h"
+#include "dict_io.h"
 
 int collision_test(){
     Dict *dict = dict_create(DICT_CAP);
 
     dict_destroy(dict);
     return 0;
-}
\ No newline at end of file
+}
+int clone_test(){
+    Dict *dict = dict_create(DICT_CAP);
+    dict_put_int(dict, "age", 25);
+    dict_put_string(dict, "name", "Mario");
+
+    Dict *snap = dict_clone(dict);
+    assert(snap != NULL);
+
+    dict_upd_int(dict, "age", 26);
+    dict_upd_string(dict, "name", "Luigi");
+    dict_put_int(dict, "new", 1);
+
+    DictValue v;
+    assert(dict_get(snap, "age", &v) && v.i == 25);
+    assert(dict_get(snap, "name", &v) && strcmp(v.s, "Mario") == 0);
+    free(v.s);
+    assert(!dict_get(snap, "new", &v));
+    assert(dict_get(dict, "name", &v) && strcmp(v.s, "Luigi") == 0);
+    free(v.s);
+
+    dict_destroy(dict);
+    assert(dict_get(snap, "age", &v) && v.i == 25);
+    dict_destroy(snap);
+    return 0;
+}
+
+int intern_test(){
+    Dict *dict = dict_create_interned(DICT_CAP);
+    dict_put_string(dict, "k1", "eu-west");
+    dict_put_string(dict, "k2", "eu-west");
+    dict_put_string(dict, "k3", "us-east");
+
+    DictEntry *e1 = slot_get(dict, get_key_cell(dict, "k1"));
+    DictEntry *e2 = slot_get(dict, get_key_cell(dict, "k2"));
+    assert(e1->value->s == e2->value->s);
+    assert(dict->strpool->size == 2);
+
+    Dict *snap = dict_clone(dict);
+    dict_upd_string(dict, "k1", "us-east");
+    dict_upd_string(dict, "k3", "ap-south");
+    assert(dict->strpool->size == 3);
+
+    DictValue v;
+    assert(dict_get(snap, "k1", &v) && strcmp(v.s, "eu-west") == 0);
+    free(v.s);
+    assert(dict_take(dict, "k1", &v) && strcmp(v.s, "us-east") == 0);
+    free(v.s);
+
+    dict_destroy(snap);
+    dict_destroy(dict);
+    return 0;
+}
+
+static int sum_int(DictValue *dst, const DictValue *src, void *ctx){
+    (void)ctx;
+    dst->i += src->i;
+    return 1;
+}
+
+static int set_label(DictValue *val, int found, void *ctx){
+    if(found && strcmp(val->s, ctx) == 0) return 0;
+    val->type = DICT_TYPE_STRING;
+    val->s = ctx;
+    return 1;
+}
+
+int update_merge_test(){
+    Dict *a = dict_create(DICT_CAP);
+    Dict *b = dict_create(DICT_CAP);
+    int n;
+
+    assert(dict_incr_int(a, "x", 2, &n) && n == 2);
+    assert(dict_incr_int(a, "x", 3, &n) && n == 5);
+    double d;
+    assert(dict_add_double(a, "y", 0.5, &d) && dict_add_double(a, "y", 1.0, &d) && d == 1.5);
+    assert(!dict_incr_int(a, "y", 1, NULL) && dict_last_error() == DICT_ERR_MIS_TYPE);
+
+    assert(dict_update_with(a, "l", set_label, "foo"));
+    assert(!dict_update_with(a, "l", set_label, "foo"));
+    assert(dict_update_with(a, "l", set_label, "bar"));
+
+    dict_incr_int(b, "x", 10, NULL);
+    dict_incr_int(b, "z", 7, NULL);
+    assert(dict_merge(a, b, sum_int, NULL));
+    dict_destroy(b);
+
+    DictValue v;
+    assert(dict_get(a, "x", &v) && v.i == 15);
+    assert(dict_get(a, "z", &v) && v.i == 7);
+    assert(dict_get(a, "l", &v) && strcmp(v.s, "bar") == 0);
+    free(v.s);
+    assert(a->size == 4);
+
+    dict_destroy(a);
+    return 0;
+}
+
+int range_test(){
+    Dict *dict = dict_create(DICT_CAP);
+    dict_put_int(dict, "t1/eu/cpu", 1);
+    dict_put_int(dict, "t42/eu/cpu", 2);
+    assert(dict_index_enable(dict));
+    dict_put_int(dict, "t42/us/mem", 3);
+    dict_put_int(dict, "t42/eu/mem", 4);
+    dict_put_int(dict, "t43/eu/cpu", 5);
+
+    DictValue v;
+    dict_take(dict, "t42/us/mem", &v);
+
+    DictRangeIter it;
+    const char *key;
+    const char *expected[] = { "t42/eu/cpu", "t42/eu/mem" };
+    int n = 0;
+    assert(dict_prefix_iter(dict, "t42/", &it));
+    while ((key = dict_range_next(&it)) != NULL) {
+        assert(strcmp(key, expected[n++]) == 0);
+    }
+    assert(n == 2);
+
+    n = 0;
+    assert(dict_range_iter(dict, "t1/", "t43", &it));
+    while (dict_range_next(&it) != NULL) n++;
+    assert(n == 3);
+    assert(dict->index->ndead == 0);  // The scan dropped the removed key.
+
+    dict_put_int(dict, "t42/us/mem", 6);  // Revives the removed key.
+    n = 0;
+    assert(dict_prefix_iter(dict, "t42/", &it));
+    while (dict_range_next(&it) != NULL) n++;
+    assert(n == 3);
+
+    Dict *snap = dict_clone(dict);
+    assert(!dict_prefix_iter(snap, "", &it) && dict_last_error() == DICT_ERR_NO_INDEX);
+    dict_destroy(snap);
+
+    dict_cleanup(dict);
+    assert(dict_prefix_iter(dict, "", &it) && dict_range_next(&it) == NULL);
+    dict_destroy(dict);
+    return 0;
+}
+
+int compact_test(){
+    assert(dict_compact_create(UINT32_MAX) == NULL && dict_last_error() == DICT_ERR_INVALID_CAPACITY);
+    DictCompact *dict = dict_compact_create(1000);
+    char key[16];
+    for(int i = 0; i < 1000; i++){
+        snprintf(key, sizeof(key), "k%d", i);
+        assert(dict_compact_put_int(dict, key, i));
+    }
+    assert(!dict_compact_put_int(dict, "extra", 0) && dict_last_error() == DICT_ERR_DICT_FULL);
+
+    DictValue v;
+    for(int i = 0; i < 1000; i += 2){
+        snprintf(key, sizeof(key), "k%d", i);
+        assert(dict_compact_take(dict, key, &v) && v.i == i);
+    }
+    for(int i = 1; i < 1000; i += 2){
+        snprintf(key, sizeof(key), "k%d", i);
+        assert(dict_compact_get(dict, key, &v) && v.i == i);
+    }
+
+    assert(dict_compact_put_string(dict, "name", "Mario"));
+    assert(dict_compact_upd_string(dict, "name", "Luigi Mario"));
+    assert(dict_compact_upd_string(dict, "name", "Wario"));
+    assert(dict_compact_get(dict, "name", &v) && strcmp(v.s, "Wario") == 0);
+    free(v.s);
+    assert(dict_compact_put_double(dict, "pi", 3.0) && dict_compact_upd_double(dict, "pi", 3.14));
+    assert(dict_compact_get(dict, "pi", &v) && v.d == 3.14);
+    assert(!dict_compact_upd_int(dict, "pi", 3) && dict_last_error() == DICT_ERR_MIS_TYPE);
+
+    dict_compact_destroy(dict);
+    return 0;
+}
+
+int io_test(){
+    const DictIOFormat fmts[] = { DICT_IO_TEXT, DICT_IO_BINARY };
+    Dict *dict = dict_create(DICT_CAP);
+    dict_put_int(dict, "age", -25);
+    dict_put_double(dict, "pi", 3.14159);
+    dict_put_string(dict, "name", "Mario\tRossi");
+    dict_put_string(dict, "empty", "");
+    dict_put_double(dict, "tiny", 1e-310);  // Subnormal: strtod sets ERANGE.
+
+    for(int f = 0; f < 2; f++){
+        FILE *tmp = tmpfile();
+        assert(dict_dump_fd(dict, fileno(tmp), fmts[f]));
+        rewind(tmp);
+
+        Dict *copy = dict_create(DICT_CAP);
+        assert(dict_load_fd(copy, fileno(tmp), fmts[f]));
+        fclose(tmp);
+
+        DictValue v;
+        assert(copy->size == 5);
+        assert(dict_get(copy, "age", &v) && v.i == -25);
+        assert(dict_get(copy, "pi", &v) && v.d == 3.14159);
+        assert(dict_get(copy, "name", &v) && strcmp(v.s, "Mario\tRossi") == 0);
+        free(v.s);
+        assert(dict_get(copy, "empty", &v) && strcmp(v.s, "") == 0);
+        free(v.s);
+        assert(dict_get(copy, "tiny", &v) && v.d == 1e-310);
+        dict_destroy(copy);
+    }
+
+    FILE *tmp = tmpfile();
+    fputs("last\ts:no newline", tmp);
+    fflush(tmp);
+    rewind(tmp);
+    assert(dict_load_fd(dict, fileno(tmp), DICT_IO_TEXT));
+    fclose(tmp);
+
+    DictValue v;
+    assert(dict_get(dict, "last", &v) && strcmp(v.s, "no newline") == 0);
+    free(v.s);
+
+    const char *text = "a\ti:1\nb\td:2.5\n\nc\ts:x";  // Read-only: never written.
+    assert(dict_load_buf(dict, text, strlen(text), DICT_IO_TEXT));
+    assert(dict_get(dict, "c", &v) && strcmp(v.s, "x") == 0);
+    free(v.s);
+    const char *bad = "z\tq:1\n";
+    assert(!dict_load_buf(dict, bad, strlen(bad), DICT_IO_TEXT) && dict_last_error() == DICT_ERR_BAD_FORMAT);
+    assert(dict->size == 9);
+
+    Dict *interned = dict_create_interned(DICT_CAP);
+    const char *same = "k1\ts:eu-west\nk2\ts:eu-west";
+    assert(dict_load_buf(interned, same, strlen(same), DICT_IO_TEXT));
+    assert(dict_get(interned, "k2", &v) && strcmp(v.s, "eu-west") == 0);
+    free(v.s);
+    assert(interned->strpool->size == 1);
+    dict_destroy(interned);
+
+    dict_destroy(dict);
+    return 0;
+}
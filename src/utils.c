@@ -25,4 +25,15 @@ long string_to_ascii_long(const char *str){
     free(output);
 
     return res;
-}
\ No newline at end of file
+}
+
+/// @brief Backward-shift deletion step for linear probing.
+/// @param home Home slot of the item found at `slot`
+/// @param hole Slot being emptied
+/// @param slot Slot after `hole` in the same probe run
+/// @return 1 if the item must stay at `slot`, 0 if it must move into `hole`
+/// @note Slots wrap around: the item stays iff its home is cyclically in (hole, slot]
+int backshift_keeps(uint32_t home, uint32_t hole, uint32_t slot){
+    return hole <= slot ? (home > hole && home <= slot)
+                        : (home > hole || home <= slot);
+}
@@ -1,7 +1,21 @@
 #ifndef UTILS_H
 #define UTILS_H
+#include <stdint.h>
+#include <string.h>
 #define MAX_KEY_LEN 6
 
 long string_to_ascii_long(const char *str);
+int backshift_keeps(uint32_t home, uint32_t hole, uint32_t slot);
+
+/* Unaligned 32-bit access to packed records, inline so it stays one load/store. */
+static inline uint32_t read_u32(const char *p){
+    uint32_t n;
+    memcpy(&n, p, sizeof(n));
+    return n;
+}
+
+static inline void write_u32(char *p, uint32_t n){
+    memcpy(p, &n, sizeof(n));
+}
 
 #endif
\ No newline at end of file